@@ -59,15 +59,8 @@ TEST(NewStyle, builderObjectWithoutType) {
 auto multiply (int x, int y) -> int;
 */
 
-class Person
-{
-public:
-    enum PersonType { ADULT, CHILD, SENIOR };
-    void setPersonType (PersonType person_type);
-    PersonType getPersonType ();
-private:
-    PersonType _person_type;
-};
+/* class Person is declared in include/Person.h */
+#include "Person.h"
 
 void Person::setPersonType (PersonType person_type)
 {
@@ -113,3 +106,143 @@ TEST(NewStyle, evenBetterBuilderObjectWithoutType) {
     ASSERT_THAT(object, ::testing::A<MyObj>());
 }
 
+
+/* fusing builder and processing steps:
+ * builder | stage | stage deduces every intermediate type with decltype and
+ * is a builder again (see include/BuilderPipeline.h)
+ */
+
+#include "BuilderPipeline.h"
+
+#include <string>
+
+struct SixBuilder {
+    constexpr int makeObject() const {
+        return 6;
+    }
+};
+
+struct AddOne {
+    constexpr int operator() (int value) const {
+        return value + 1;
+    }
+};
+
+struct Square {
+    constexpr long operator() (int value) const {
+        return static_cast<long>(value) * value;
+    }
+};
+
+TEST(Pipeline, isEvaluatedAtCompileTime) {
+    constexpr auto pipeline = SixBuilder() | AddOne() | Square();
+    static_assert(pipeline.makeObject() == 49, "pipeline is not constexpr");
+    ASSERT_THAT(pipeline.makeObject(), ::testing::A<long>());
+}
+
+TEST(Pipeline, worksWithLambdaStages) {
+    int calls = 0;
+    auto pipeline = SixBuilder()
+            | [&calls] (int value) -> int { ++calls; return value * 7; }
+            | [&calls] (int value) -> std::string { ++calls; return std::to_string(value); };
+
+    ASSERT_THAT(pipeline.makeObject(), ::testing::Eq("42"));
+    ASSERT_THAT(calls, ::testing::Eq(2));
+}
+
+TEST(Pipeline, isABuilderItself) {
+    auto pipeline = MyObjBuilder() | [] (MyObj obj) { return obj; };
+    makeAndProcessObject( pipeline );
+
+    auto object = evenBettermakeAndProcessObject( pipeline | [] (MyObj) { return 42; } );
+    ASSERT_THAT(object, ::testing::Eq(42));
+}
+
+/* many persons: a column store packing the person type into 2 bits per record
+ * (see include/PersonTable.h)
+ */
+
+#include "PersonTable.h"
+
+TEST(PersonTable, packsTypeIntoTwoBits) {
+    CPersonTable table(100, Person::SENIOR);
+    ASSERT_THAT(table.size(), ::testing::Eq(100u));
+    ASSERT_THAT(table.typeColumnBytes(), ::testing::Eq(4 * sizeof(std::uint64_t)));
+    ASSERT_THAT(table.getPersonType(99), ::testing::Eq(Person::SENIOR));
+
+    table.setPersonType(42, Person::CHILD);
+    ASSERT_THAT(table.getPersonType(41), ::testing::Eq(Person::SENIOR));
+    ASSERT_THAT(table.getPersonType(42), ::testing::Eq(Person::CHILD));
+    ASSERT_THAT(table.getPersonType(43), ::testing::Eq(Person::SENIOR));
+
+    ASSERT_THROW(table.getPersonType(100), std::out_of_range);
+}
+
+TEST(PersonTable, countsByType) {
+    CPersonTable table;
+    for ( int i = 0; i < 1000; ++i ) {
+        table.push_back(static_cast<Person::PersonType>(i % 3));
+    }
+
+    ASSERT_THAT(table.countByType(), ::testing::ElementsAre(334u, 333u, 333u));
+}
+
+TEST(PersonTable, filtersIndicesByType) {
+    CPersonTable table(70);
+    table.setPersonType(3, Person::CHILD);
+    table.setPersonType(31, Person::CHILD);
+    table.setPersonType(32, Person::SENIOR);
+    table.setPersonType(69, Person::CHILD);
+
+    ASSERT_THAT(table.indicesOf(Person::CHILD), ::testing::ElementsAre(3u, 31u, 69u));
+    ASSERT_THAT(table.indicesOf(Person::SENIOR), ::testing::ElementsAre(32u));
+    ASSERT_THAT(table.indicesOf(Person::ADULT).size(), ::testing::Eq(66u));
+}
+
+TEST(PersonTable, setsTypeForRange) {
+    CPersonTable table(200);
+    table.setPersonType(10, 150, Person::SENIOR);
+    table.setPersonType(20, 25, Person::CHILD);
+
+    auto histogram = table.countByType();
+    ASSERT_THAT(histogram[Person::ADULT], ::testing::Eq(60u));
+    ASSERT_THAT(histogram[Person::CHILD], ::testing::Eq(5u));
+    ASSERT_THAT(histogram[Person::SENIOR], ::testing::Eq(135u));
+    ASSERT_THAT(table.getPersonType(9), ::testing::Eq(Person::ADULT));
+    ASSERT_THAT(table.getPersonType(10), ::testing::Eq(Person::SENIOR));
+    ASSERT_THAT(table.getPersonType(149), ::testing::Eq(Person::SENIOR));
+    ASSERT_THAT(table.getPersonType(150), ::testing::Eq(Person::ADULT));
+}
+
+TEST(PersonTable, keepsNamesInTheirOwnColumn) {
+    CPersonTable table(40, Person::CHILD);
+    table.push_back(Person::SENIOR, "Stefan");
+    table.push_back(Person::ADULT, "Tom");
+    table.setName(3, "Stefan");
+
+    ASSERT_THAT(table.getName(40).str(), ::testing::Eq("Stefan"));
+    ASSERT_THAT(table.getName(41).str(), ::testing::Eq("Tom"));
+    ASSERT_THAT(table.getName(3).str(), ::testing::Eq("Stefan"));
+    ASSERT_TRUE(table.getName(0).empty());
+    // the type column is not affected
+    ASSERT_THAT(table.getPersonType(40), ::testing::Eq(Person::SENIOR));
+    ASSERT_THAT(table.countByType(), ::testing::ElementsAre(1u, 40u, 1u));
+    ASSERT_THROW(table.setName(42, "Jane"), std::out_of_range);
+}
+
+TEST(PersonTable, largeTableIsProcessedInChunks) {
+    const std::size_t size = 10 * 1000 * 1000 + 7;
+    CPersonTable table(size, Person::CHILD);
+    table.setPersonType(1000, size - 1000, Person::ADULT);
+    table.setPersonType(size - 1, Person::SENIOR);
+
+    auto histogram = table.countByType();
+    ASSERT_THAT(histogram[Person::ADULT], ::testing::Eq(size - 2000));
+    ASSERT_THAT(histogram[Person::CHILD], ::testing::Eq(1999u));
+    ASSERT_THAT(histogram[Person::SENIOR], ::testing::Eq(1u));
+
+    auto indices = table.indicesOf(Person::CHILD);
+    ASSERT_THAT(indices.size(), ::testing::Eq(1999u));
+    ASSERT_THAT(indices.front(), ::testing::Eq(0u));
+    ASSERT_THAT(indices.back(), ::testing::Eq(size - 2));
+}
@@ -19,6 +19,7 @@
 #include <initializer_list>
 #include <string>
 #include <map>
+#include <algorithm>
 
 /* The Basics */
 
@@ -65,6 +66,122 @@ TEST(BraceInitialization, SupportsMaps) {
     ASSERT_THAT(mapSizes["Tom"], ::testing::Eq(185));
 }
 
+/* ... and flat maps: no allocation per entry, lookups with a string literal
+ * or CStringRef do not build a std::string (see include/FlatHashMap.h and
+ * include/SortedFlatMap.h) */
+
+#include "FlatHashMap.h"
+#include "SortedFlatMap.h"
+#include "TracingMatchers.h"
+
+TEST(BraceInitialization, SupportsFlatHashMaps) {
+    CFlatHashMap<std::string,unsigned int> mapSizes {
+        {"Stefan", 180}, {"Tom", 185}
+    };
+
+    ASSERT_THAT(mapSizes["Stefan"], ::testing::Eq(180));
+    ASSERT_THAT(mapSizes.at("Tom"), ::testing::Eq(185));
+    ASSERT_THAT(mapSizes.count(CStringRef("Tomcat", 3)), ::testing::Eq(1u));
+    ASSERT_THAT(mapSizes.find("Jane") == mapSizes.end(), ::testing::Eq(true));
+}
+
+TEST(BraceInitialization, SupportsSortedFlatMaps) {
+    CSortedFlatMap<std::string,unsigned int> mapSizes {
+        {"Tom", 185}, {"Stefan", 180}, {"Tom", 190}
+    };
+
+    ASSERT_THAT(mapSizes.size(), ::testing::Eq(2u));
+    ASSERT_THAT(mapSizes.begin()->first, ::testing::Eq("Stefan"));
+    ASSERT_THAT(mapSizes["Stefan"], ::testing::Eq(180));
+    ASSERT_THAT(mapSizes.at("Tom"), ::testing::Eq(185)); // first one wins as with std::map
+    ASSERT_THAT(mapSizes.count(CStringRef("Tomcat", 3)), ::testing::Eq(1u));
+    ASSERT_THROW(mapSizes.at("Jane"), std::out_of_range);
+}
+
+TEST(FlatHashMap, GrowsAndErases) {
+    CFlatHashMap<int,int> mapSquares;
+    for ( int i = 0; i < 10000; ++i ) {
+        mapSquares[i] = i * i;
+    }
+    for ( int i = 0; i < 10000; i += 2 ) {
+        ASSERT_THAT(mapSquares.erase(i), ::testing::Eq(1u));
+    }
+
+    ASSERT_THAT(mapSquares.size(), ::testing::Eq(5000u));
+    ASSERT_THAT(mapSquares.count(42), ::testing::Eq(0u));
+    ASSERT_THAT(mapSquares.at(43), ::testing::Eq(43 * 43));
+
+    long long sum = 0;
+    for ( auto& entry : mapSquares ) {
+        sum += entry.first;
+    }
+    ASSERT_THAT(sum, ::testing::Eq(25000000LL));
+
+    // reusing erased slots must not grow the table
+    std::size_t capacity = mapSquares.capacity();
+    for ( int round = 0; round < 10; ++round ) {
+        for ( int i = 0; i < 10000; i += 2 ) {
+            mapSquares[i] = 0;
+        }
+        for ( int i = 0; i < 10000; i += 2 ) {
+            mapSquares.erase(i);
+        }
+    }
+    ASSERT_THAT(mapSquares.capacity(), ::testing::Eq(capacity));
+}
+
+TEST(FlatHashMap, ErasesThroughIterators) {
+    CFlatHashMap<std::string, unsigned int> mapSizes{ {"Stefan", 180}, {"Tom", 185}, {"Jane", 170} };
+    auto itr = mapSizes.erase(mapSizes.find("Tom"));
+    ASSERT_THAT(mapSizes.size(), ::testing::Eq(2u));
+    ASSERT_THAT(mapSizes.count("Tom"), ::testing::Eq(0u));
+    ASSERT_TRUE(itr == mapSizes.end() || itr->first != "Tom");
+    const CFlatHashMap<std::string, unsigned int> & constSizes = mapSizes;
+    mapSizes.erase(constSizes.find("Jane"));
+    ASSERT_THAT(mapSizes.size(), ::testing::Eq(1u));
+
+    CSortedFlatMap<std::string, unsigned int> mapSorted{ {"Stefan", 180}, {"Tom", 185} };
+    auto itrSorted = mapSorted.erase(mapSorted.find("Stefan"));
+    ASSERT_THAT(itrSorted->first, ::testing::Eq("Tom"));
+    ASSERT_THAT(mapSorted.size(), ::testing::Eq(1u));
+}
+
+// a growing std::vector of maps moves them
+static_assert(std::is_nothrow_move_constructible<CFlatHashMap<std::string, unsigned int>>::value,
+              "CFlatHashMap: move constructor not noexcept");
+
+TEST(FlatHashMap, LooksUpStringKeysWithoutAllocating) {
+    CFlatHashMap<std::string, unsigned int> mapSizes{ {"Stefan", 180}, {"Tom", 185} };
+
+    CTraceScope trace;
+    unsigned int size = mapSizes.find("Stefan")->second;
+    std::size_t count = mapSizes.count("Jane");
+    mapSizes["Tom"] = 186;
+    EXPECT_ALLOCATIONS(0);  // no temporary std::string
+
+    ASSERT_THAT(size, ::testing::Eq(180u));
+    ASSERT_THAT(count, ::testing::Eq(0u));
+    ASSERT_THAT(mapSizes.at("Tom"), ::testing::Eq(186u));
+}
+
+TEST(FlatHashMap, BuildsFromRange) {
+    std::vector<std::pair<std::string, unsigned int>> vecSizes;
+    for ( unsigned int i = 0; i < 1000; ++i ) {
+        vecSizes.push_back(std::make_pair("person" + std::to_string(i), 150 + i % 50));
+    }
+
+    CFlatHashMap<std::string, unsigned int> mapHashed(vecSizes.begin(), vecSizes.end());
+    CSortedFlatMap<std::string, unsigned int> mapSorted(vecSizes.begin(), vecSizes.end());
+
+    ASSERT_THAT(mapHashed.size(), ::testing::Eq(1000u));
+    ASSERT_THAT(mapSorted.size(), ::testing::Eq(1000u));
+    for ( auto& entry : vecSizes ) {
+        ASSERT_THAT(mapHashed.at(entry.first), ::testing::Eq(entry.second));
+        ASSERT_THAT(mapSorted.at(entry.first), ::testing::Eq(entry.second));
+    }
+    ASSERT_TRUE(std::is_sorted(mapSorted.begin(), mapSorted.end()));
+}
+
 
 /* compare to old school initialisation */
 
@@ -90,6 +207,59 @@ TEST(BraceInitialization, CanBeUsedOnConstructionInitializationList) {
     ASSERT_THAT(card.strArrayGrades, ::testing::ElementsAre("A", "B", "C", "D", "F"));
 }
 
+/* tables fixed at compile time do not need a heap container at all: the
+ * compiler builds a perfect hash from the braced list (see
+ * include/PerfectHashTable.h) */
+
+#include "PerfectHashTable.h"
+
+constexpr auto gradePoints = makePerfectHashTable<int>({
+    {"A", 4}, {"B", 3}, {"C", 2}, {"D", 1}, {"F", 0}
+});
+
+static_assert(gradePoints.at("B") == 3, "lookup works at compile time");
+
+TEST(BraceInitialization, CanBuildPerfectHashTablesAtCompileTime) {
+    ASSERT_THAT(gradePoints.size(), ::testing::Eq(5u));
+    ASSERT_THAT(*gradePoints.find("A"), ::testing::Eq(4));
+    ASSERT_THAT(*gradePoints.find(std::string("F")), ::testing::Eq(0));
+    ASSERT_THAT(gradePoints.find("E"), ::testing::IsNull());
+    ASSERT_THAT(gradePoints.find("AA"), ::testing::IsNull());
+    ASSERT_THAT(gradePoints.find(""), ::testing::IsNull());
+    ASSERT_THROW(gradePoints.at("E"), std::out_of_range);
+}
+
+TEST(PerfectHashTable, LooksUpWithoutAllocating) {
+    const std::string strGrade("C");
+
+    CTraceScope trace;
+    const int * pPoints = gradePoints.find(strGrade);
+    const int * pMissing = gradePoints.find("E");
+    EXPECT_ALLOCATIONS(0);
+
+    ASSERT_THAT(*pPoints, ::testing::Eq(2));
+    ASSERT_THAT(pMissing, ::testing::IsNull());
+}
+
+TEST(PerfectHashTable, PlacesEveryKeyInItsOwnSlot) {
+    static constexpr auto mapSizes = makePerfectHashTable<unsigned int>({
+        {"Stefan", 180}, {"Tom", 185}, {"Jane", 165}, {"Joe", 178}, {"Ann", 170},
+        {"Bob", 190}, {"Carl", 175}, {"Dora", 160}, {"Eve", 168}, {"Fred", 182},
+        {"Gina", 172}, {"Hank", 188}, {"Ida", 158}, {"Jack", 181}, {"Kim", 164},
+        {"Lou", 177}, {"Max", 186}, {"Ned", 179}, {"Olga", 171}, {"Paul", 183}
+    });
+
+    std::vector<std::string> vecKeys;
+    for ( std::size_t slot = 0; slot < mapSizes.size(); ++slot ) {
+        vecKeys.push_back(mapSizes.keyAt(slot));
+        ASSERT_THAT(mapSizes.find(vecKeys.back()), ::testing::Eq(&mapSizes.at(mapSizes.keyAt(slot))));
+    }
+    std::sort(vecKeys.begin(), vecKeys.end());
+    ASSERT_THAT(std::unique(vecKeys.begin(), vecKeys.end()) - vecKeys.begin(), ::testing::Eq(20));
+    ASSERT_THAT(*mapSizes.find("Stefan"), ::testing::Eq(180u));
+    ASSERT_THAT(*mapSizes.find("Paul"), ::testing::Eq(183u));
+}
+
 TEST(BraceInitialization, CanBeUsedForReturnValues) {
     struct ReportCard {
         std::vector<std::string> gradesForAllClasses() {
@@ -144,14 +314,14 @@ TEST(MemInit, OverridesMemberVariableInitialization) {
 TEST(BraceInitialization, EliminatesNeedToSpecifyTempTypeName) {
     struct StudentScore {
         StudentScore(std::string strName, int iScore)
-        : m_strName(strName), m_iScore(iScore) {}
+        : m_strName(std::move(strName)), m_iScore(iScore) {}
         std::string m_strName;
         int m_iScore;
     };
     struct ReportCard {
         std::vector<StudentScore> m_vecScores;
         void AddStudentScore(StudentScore score) {
-            m_vecScores.push_back(score);
+            m_vecScores.push_back(std::move(score)); // the temporary is ours, no need to copy
         }
     } card;
 
@@ -163,6 +333,118 @@ TEST(BraceInitialization, EliminatesNeedToSpecifyTempTypeName) {
     ASSERT_THAT(studentScore.m_iScore, ::testing::Eq(93));
 }
 
+/* millions of scores: names interned once, rankings updated on insert
+ * (see include/ScoreBoard.h) */
+
+#include "ScoreBoard.h"
+
+#include <cmath>
+#include <limits>
+
+TEST(ScoreBoard, InternsNamesAndKeepsTopScores) {
+    CScoreBoard board(2);
+    board.addStudentScore("Jane", 93);
+    board.addStudentScore("Tom", 71);
+    board.addStudentScore("Jane", 88);
+    board.addStudentScore("Stefan", 93);
+
+    ASSERT_THAT(board.size(), ::testing::Eq(4u));
+    ASSERT_THAT(board.scores()[0].m_nameId, ::testing::Eq(board.scores()[2].m_nameId));
+    ASSERT_THAT(board.name(board.scores()[3].m_nameId).str(), ::testing::Eq("Stefan"));
+
+    auto vecTop = board.top();
+    ASSERT_THAT(vecTop.size(), ::testing::Eq(2u));
+    ASSERT_THAT(vecTop[0].m_name.str(), ::testing::Eq("Jane"));
+    ASSERT_THAT(vecTop[0].m_iScore, ::testing::Eq(93));
+    ASSERT_THAT(vecTop[1].m_name.str(), ::testing::Eq("Stefan"));
+    ASSERT_THAT(vecTop[1].m_iScore, ::testing::Eq(93));
+}
+
+TEST(ScoreBoard, AnswersPercentilesIncrementally) {
+    CScoreBoard board(10);
+    for ( int i = 1; i <= 100; ++i ) {
+        board.addStudentScore("student" + std::to_string(i % 7), i);
+    }
+
+    ASSERT_THAT(board.percentile(50), ::testing::Eq(50));
+    ASSERT_THAT(board.percentile(90), ::testing::Eq(90));
+    ASSERT_THAT(board.percentile(0), ::testing::Eq(1));
+    ASSERT_THAT(board.percentile(100), ::testing::Eq(100));
+    ASSERT_THAT(board.countAtLeast(91), ::testing::Eq(10u));
+    ASSERT_THAT(board.countAtMost(0), ::testing::Eq(0u));
+
+    board.addStudentScore("late", 0);
+    ASSERT_THAT(board.percentile(0), ::testing::Eq(0));
+    ASSERT_THAT(board.top().back().m_iScore, ::testing::Eq(91));
+}
+
+TEST(ScoreBoard, HandlesTheEdgesOfTheRanges) {
+    CScoreBoard board(3);
+    board.addStudentScore("Jane", 50);
+    ASSERT_THROW(board.percentile(-1), std::out_of_range);
+    ASSERT_THROW(board.percentile(100.5), std::out_of_range);
+    ASSERT_THROW(board.percentile(std::nan("")), std::out_of_range);
+    ASSERT_THAT(board.countAtLeast(std::numeric_limits<int>::min()), ::testing::Eq(1u));
+
+    const int iMin = std::numeric_limits<int>::min();
+    const int iMax = std::numeric_limits<int>::max();
+    CScoreBoard low(3, iMin, iMin + 10);
+    low.addStudentScore("Tom", iMin);
+    low.addStudentScore("Stefan", iMin + 5);
+    ASSERT_THAT(low.countAtLeast(iMin), ::testing::Eq(2u));
+    ASSERT_THAT(low.countAtLeast(iMin + 1), ::testing::Eq(1u));
+    ASSERT_THAT(low.countAtMost(iMax), ::testing::Eq(2u));
+    ASSERT_THAT(low.percentile(0), ::testing::Eq(iMin));
+    ASSERT_THAT(low.percentile(100), ::testing::Eq(iMin + 5));
+
+    CScoreBoard high(3, iMax - 10, iMax);
+    high.addStudentScore("Tom", iMax);
+    ASSERT_THAT(high.countAtLeast(iMax), ::testing::Eq(1u));
+    ASSERT_THAT(high.countAtMost(iMin), ::testing::Eq(0u));
+    ASSERT_THAT(high.percentile(50), ::testing::Eq(iMax));
+}
+
+TEST(ScoreBoard, IngestsKnownNamesWithoutAllocating) {
+    CScoreBoard board(10);
+    board.reserve(10000, 100);
+    std::vector<std::string> vecNames;
+    for ( int i = 0; i < 100; ++i ) {
+        vecNames.push_back("student" + std::to_string(i));
+        board.addStudentScore(vecNames.back(), i);
+    }
+
+    CTraceScope trace;
+    for ( int i = 100; i < 10000; ++i ) {
+        board.addStudentScore(vecNames[i % 100], i % 101);
+    }
+    EXPECT_ALLOCATIONS(0);
+    ASSERT_THAT(board.size(), ::testing::Eq(10000u));
+}
+
+TEST(ScoreBoard, RejectsScoresOutOfRange) {
+    CScoreBoard board(3, 0, 100);
+    ASSERT_THROW(board.addStudentScore("Jane", 101), std::out_of_range);
+    ASSERT_THROW(board.percentile(50), std::logic_error);
+}
+
+TEST(StringPool, StoresStringsLargerThanABlock) {
+    CStringPool pool;
+    const std::string large(100000, 'a');
+    CStringPool::Id idLarge = pool.intern(large);
+    CStringPool::Id idShort = pool.intern("bb");
+    CStringPool::Id idNext = pool.intern("ccc");
+    pool.intern(std::string(70000, 'd'));
+    CStringPool::Id idLast = pool.intern("ee");
+
+    ASSERT_THAT(pool.str(idLarge).str(), ::testing::Eq(large));
+    ASSERT_THAT(pool.str(idShort).str(), ::testing::Eq("bb"));
+    ASSERT_THAT(pool.str(idNext).str(), ::testing::Eq("ccc"));
+    ASSERT_THAT(pool.str(idLast).str(), ::testing::Eq("ee"));
+    // the short strings share one block
+    ASSERT_THAT(pool.str(idNext).data(), ::testing::Eq(pool.str(idShort).data() + 2));
+    ASSERT_THAT(pool.str(idLast).data(), ::testing::Eq(pool.str(idNext).data() + 3));
+}
+
 
 /* Defaults */
 
@@ -250,3 +532,295 @@ TEST(BraceInitialization, AvoidsTheMostVexingParse) {
 }
 /**/
 
+
+/* the library again, now with a cache and batched, asynchronous lookups in
+ * front of the isbn service (see include/IsbnLookup.h) */
+
+#include "IsbnLookup.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+/* in process stand-in for the remote service */
+class CLocalIsbnService : public CIsbnService {
+public:
+    explicit CLocalIsbnService(std::chrono::microseconds latency) :
+        m_latency(latency), m_calls(0), m_isbns(0), m_bFail(false), m_bDropLast(false) {}
+
+    std::vector<std::string> lookupMany(const std::vector<std::string> & vecIsbns) override {
+        ++m_calls;
+        m_isbns += vecIsbns.size();
+        std::this_thread::sleep_for(m_latency);
+        if ( m_bFail ) {
+            throw std::runtime_error("service unavailable");
+        }
+        std::vector<std::string> vecNames;
+        for ( auto& isbn : vecIsbns ) {
+            vecNames.push_back("book " + isbn);
+        }
+        if ( m_bDropLast ) {
+            vecNames.pop_back();
+        }
+        return vecNames;
+    }
+
+    std::chrono::microseconds m_latency;
+    std::atomic<int> m_calls;
+    std::atomic<std::size_t> m_isbns;
+    std::atomic<bool> m_bFail;
+    std::atomic<bool> m_bDropLast; // a broken backend: one name too few
+};
+
+/* holds every call until the test releases it; calls are numbered from 1 in
+ * the order they arrive, call number failingCall fails */
+class CGatedIsbnService : public CIsbnService {
+public:
+    explicit CGatedIsbnService(int failingCall = 0) : m_failingCall(failingCall), m_arrived(0), m_released(0) {}
+
+    std::vector<std::string> lookupMany(const std::vector<std::string> & vecIsbns) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const int call = ++m_arrived;
+        m_changed.notify_all();
+        m_changed.wait(lock, [this, call] () { return m_released >= call; });
+        if ( call == m_failingCall ) {
+            throw std::runtime_error("service unavailable");
+        }
+        m_vecCallSizes.push_back(vecIsbns.size());
+        std::vector<std::string> vecNames;
+        for ( auto& isbn : vecIsbns ) {
+            vecNames.push_back("book " + isbn);
+        }
+        return vecNames;
+    }
+
+    // isbns per successful call
+    std::vector<std::size_t> callSizes() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_vecCallSizes;
+    }
+
+    void waitArrived(int calls) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this, calls] () { return m_arrived >= calls; });
+    }
+
+    // lets calls 1 .. calls finish
+    void release(int calls) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_released = calls;
+        m_changed.notify_all();
+    }
+
+private:
+    const int m_failingCall;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    int m_arrived;
+    int m_released;
+    std::vector<std::size_t> m_vecCallSizes;
+};
+
+/* the Library of AvoidsTheMostVexingParse, backed by the cache */
+struct Library {
+    CCachingIsbnLookup m_Lookup;
+    Library(CIsbnService & service) : m_Lookup{service, 100} {}
+    std::string Lookup(const std::string& m_strIsbn) {
+        PROFILE_SCOPE("Library::Lookup");
+        return m_Lookup.lookup(m_strIsbn);
+    }
+};
+
+TEST(IsbnLookup, CachesLibraryLookups) {
+    CLocalIsbnService service(std::chrono::microseconds(0));
+    Library library{service};
+
+    ASSERT_THAT(library.Lookup("123"), ::testing::Eq("book 123"));
+    ASSERT_THAT(library.Lookup("123"), ::testing::Eq("book 123"));
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(1));
+}
+
+TEST(IsbnLookup, ProfilesLibraryLookups) {
+    CProfiler & profiler = CProfiler::instance();
+    profiler.reset();
+    profiler.setEnabled(true);
+    {
+        CLocalIsbnService service(std::chrono::microseconds(100));
+        Library library{service};
+        for ( int i = 0; i < 10; ++i ) {
+            library.Lookup(std::to_string(i % 4));
+        }
+    }
+    profiler.setEnabled(false);
+
+    // the backend is called from the dispatcher thread, merged in the snapshot
+    CProfileSnapshot snapshot = profiler.snapshot();
+    ASSERT_THAT(snapshot.find("Library::Lookup")->m_latency.count(), ::testing::Eq(10u));
+    ASSERT_THAT(snapshot.find("CIsbnService::lookupMany")->m_latency.count(), ::testing::Eq(4u));
+    ASSERT_THAT(snapshot.find("CIsbnService::isbns")->m_counter, ::testing::Eq(4u));
+    ASSERT_THAT(snapshot.percentileNs(*snapshot.find("CIsbnService::lookupMany"), 50), ::testing::Ge(90000.0));
+}
+
+TEST(IsbnLookup, BatchesMissesIntoOneBackendCall) {
+    CLocalIsbnService service(std::chrono::microseconds(0));
+    CCachingIsbnLookup lookup(service, 100);
+
+    auto vecNames = lookup.lookupMany({"1", "2", "3"});
+    ASSERT_THAT(vecNames[2].get(), ::testing::Eq("book 3"));
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(1));
+
+    vecNames = lookup.lookupMany({"2", "4", "1"});
+    ASSERT_THAT(vecNames[0].get(), ::testing::Eq("book 2"));
+    ASSERT_THAT(vecNames[1].get(), ::testing::Eq("book 4"));
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(2));
+    ASSERT_THAT(service.m_isbns.load(), ::testing::Eq(4u));
+    ASSERT_THAT(lookup.stats().m_hits, ::testing::Eq(2u));
+}
+
+TEST(IsbnLookup, BatchesMissesOfConcurrentCallers) {
+    CGatedIsbnService service;
+    CCachingIsbnLookup lookup(service, 100);
+
+    // keeps the dispatcher busy while the others queue up
+    auto vecFirst = lookup.lookupMany({"0"});
+    service.waitArrived(1);
+    std::vector<std::thread> vecThreads;
+    for ( int i = 1; i <= 8; ++i ) {
+        vecThreads.emplace_back([&lookup, i] () {
+            EXPECT_THAT(lookup.lookup(std::to_string(i)), ::testing::Eq("book " + std::to_string(i)));
+        } );
+    }
+    while ( lookup.stats().m_misses < 9 ) {
+        std::this_thread::yield();
+    }
+    service.release(2);
+    for ( auto& thread : vecThreads ) {
+        thread.join();
+    }
+
+    EXPECT_THAT(vecFirst[0].get(), ::testing::Eq("book 0"));
+    EXPECT_THAT(service.callSizes(), ::testing::ElementsAre(1u, 8u));
+    EXPECT_THAT(lookup.stats().m_backendCalls, ::testing::Eq(2u));
+}
+
+TEST(IsbnLookup, CollapsesConcurrentRequestsForTheSameIsbn) {
+    CLocalIsbnService service(std::chrono::milliseconds(50));
+    CCachingIsbnLookup lookup(service, 100);
+
+    std::vector<std::thread> vecThreads;
+    for ( int i = 0; i < 8; ++i ) {
+        vecThreads.emplace_back([&lookup] () {
+            ASSERT_THAT(lookup.lookup("42"), ::testing::Eq("book 42"));
+        } );
+    }
+    for ( auto& thread : vecThreads ) {
+        thread.join();
+    }
+
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(1));
+}
+
+TEST(IsbnLookup, RetriesAfterBackendFailure) {
+    CLocalIsbnService service(std::chrono::microseconds(0));
+    CCachingIsbnLookup lookup(service, 100);
+
+    service.m_bFail = true;
+    ASSERT_THROW(lookup.lookup("123"), std::runtime_error);
+
+    service.m_bFail = false;
+    ASSERT_THAT(lookup.lookup("123"), ::testing::Eq("book 123"));
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(2));
+}
+
+TEST(IsbnLookup, KeepsNamesDeliveredBeforeAFailure) {
+    CLocalIsbnService service(std::chrono::microseconds(0));
+    CCachingIsbnLookup lookup(service, 100);
+
+    service.m_bDropLast = true;
+    auto vecNames = lookup.lookupMany({"1", "2"});
+    ASSERT_THAT(vecNames[0].get(), ::testing::Eq("book 1"));
+    ASSERT_THROW(vecNames[1].get(), std::out_of_range);
+
+    service.m_bDropLast = false;
+    ASSERT_THAT(lookup.lookup("1"), ::testing::Eq("book 1"));
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(1));
+    ASSERT_THAT(lookup.lookup("2"), ::testing::Eq("book 2"));
+    ASSERT_THAT(service.m_calls.load(), ::testing::Eq(2));
+}
+
+TEST(IsbnLookup, FailureKeepsANewerFetchOfTheSameIsbn) {
+    CGatedIsbnService service(1);
+    CCachingIsbnLookup lookup(service, 1, 1);
+
+    auto vecFailing = lookup.lookupMany({"x"});
+    service.waitArrived(1);
+    auto vecOther = lookup.lookupMany({"y"}); // evicts x, queued
+    auto vecNewer = lookup.lookupMany({"x"}); // fetches x again, evicts y, queued
+
+    service.release(1);
+    EXPECT_THROW(vecFailing[0].get(), std::runtime_error);
+    // collapses onto the newer fetch, which the failure must not have erased
+    auto vecLater = lookup.lookupMany({"x"});
+    service.release(2);
+
+    EXPECT_THAT(vecLater[0].get(), ::testing::Eq("book x"));
+    EXPECT_THAT(vecNewer[0].get(), ::testing::Eq("book x"));
+    EXPECT_THAT(vecOther[0].get(), ::testing::Eq("book y"));
+    EXPECT_THAT(lookup.stats().m_backendCalls, ::testing::Eq(2u));
+    EXPECT_THAT(lookup.stats().m_collapsed, ::testing::Eq(1u));
+}
+
+TEST(IsbnLookup, ReportsHitRateAndLatency) {
+    CLocalIsbnService service(std::chrono::milliseconds(2));
+    CCachingIsbnLookup lookup(service, 64, 8);
+
+    std::vector<std::vector<double>> vecLatencies(4);
+    std::vector<std::set<unsigned int>> vecRequested(4);
+    std::vector<std::thread> vecThreads;
+    for ( std::size_t t = 0; t < vecLatencies.size(); ++t ) {
+        vecThreads.emplace_back([&lookup, &vecLatencies, &vecRequested, t] () {
+            for ( unsigned int i = 0; i < 200; ++i ) {
+                // skewed: most requests go to few isbns
+                unsigned int isbn = (i * 7919u + t * 104729u) % 1000;
+                isbn = isbn < 900 ? isbn % 32 : isbn;
+                vecRequested[t].insert(isbn);
+                auto start = std::chrono::steady_clock::now();
+                lookup.lookup(std::to_string(isbn));
+                vecLatencies[t].push_back(std::chrono::duration<double, std::micro>(
+                        std::chrono::steady_clock::now() - start).count());
+            }
+        } );
+    }
+    for ( auto& thread : vecThreads ) {
+        thread.join();
+    }
+
+    std::vector<double> vecAll;
+    for ( auto& vec : vecLatencies ) {
+        vecAll.insert(vecAll.end(), vec.begin(), vec.end());
+    }
+    std::set<unsigned int> setRequested;
+    for ( auto& set : vecRequested ) {
+        setRequested.insert(set.begin(), set.end());
+    }
+    std::sort(vecAll.begin(), vecAll.end());
+    auto stats = lookup.stats();
+    // in the XML report of --gtest_output
+    RecordProperty("hitRate", std::to_string(stats.hitRate()));
+    RecordProperty("collapsedRate", std::to_string(stats.collapsedRate()));
+    RecordProperty("p50us", std::to_string(vecAll[vecAll.size() / 2]));
+    RecordProperty("p99us", std::to_string(vecAll[vecAll.size() * 99 / 100]));
+    RecordProperty("backendCalls", static_cast<int>(stats.m_backendCalls));
+
+    // no absolute latencies: they depend on the load of the machine
+    ASSERT_THAT(stats.m_hits + stats.m_collapsed + stats.m_misses, ::testing::Eq(800u));
+    ASSERT_THAT(stats.m_misses, ::testing::Ge(setRequested.size()));
+    ASSERT_THAT(stats.m_backendCalls, ::testing::Le(stats.m_misses));
+    ASSERT_THAT(stats.hitRate(), ::testing::Gt(0.5));
+    ASSERT_THAT(vecAll.front(), ::testing::Le(vecAll[vecAll.size() / 2]));
+    ASSERT_THAT(vecAll[vecAll.size() / 2], ::testing::Le(vecAll[vecAll.size() * 99 / 100]));
+}
@@ -27,29 +27,13 @@ TEST(Lambda, Basics){
 #include <string>
 #include <vector>
 
-class CAddressBook {
-public:
-    // using a template allows us to ignore the differences between functors, function pointers
-    // and lambda
-    template<typename Func>
-    std::vector<std::string> findMatchingAddresses (Func func) const {
-        std::vector<std::string> vec_results;
-        for ( auto itr = m_strAddresses.begin(), end = m_strAddresses.end(); itr != end; ++itr ) {
-            // call the function passed into findMatchingAddresses and see if it matches
-            if ( func( *itr ) ) {
-                vec_results.push_back( *itr );
-            }
-        }
-        return vec_results;
-    }
+#include "Profiler.h"
 
-    void addAddress(std::string strAddress) {
-        m_strAddresses.emplace_back(strAddress);
-    }
+#include <cstdint>
 
-private:
-    std::vector<std::string> m_strAddresses;
-};
+/* class CAddressBook is declared in include/AddressBook.h: its findMatchingAddresses
+ * is a template, so it takes any function, functor or lambda */
+#include "AddressBook.h"
 
 std::vector<std::string> findAddressesFromOrgs(CAddressBook const & addressBook) {
     return addressBook.findMatchingAddresses(
@@ -69,6 +53,51 @@ TEST(Lambda, AddressbookOrgSearch) {
 }
 
 
+/* looking inside: the search is a profiled hot path (see include/Profiler.h) */
+
+TEST(Lambda, AddressbookSearchIsProfiled) {
+    CAddressBook addressBook;
+    addressBook.addAddress("stefan.weigand@triagnosys.com");
+    addressBook.addAddress("somebody@some.org");
+
+    CProfiler & profiler = CProfiler::instance();
+    profiler.reset();
+    profiler.setEnabled(true);
+    for ( int i = 0; i < 3; ++i ) {
+        findAddressesFromOrgs(addressBook);
+    }
+    profiler.setEnabled(false);
+    findAddressesFromOrgs(addressBook); // not recorded
+
+    CProfileSnapshot snapshot = profiler.snapshot();
+    const CProfileSnapshot::CProbe * pProbe = snapshot.find("CAddressBook::findMatchingAddresses");
+    ASSERT_THAT(pProbe, ::testing::NotNull());
+    ASSERT_THAT(pProbe->m_latency.count(), ::testing::Eq(3u));
+    ASSERT_THAT(snapshot.percentileNs(*pProbe, 99), ::testing::Gt(0.0));
+    ASSERT_THAT(snapshot.json(), ::testing::HasSubstr(
+            "{\"name\":\"CAddressBook::findMatchingAddresses\",\"count\":3,\"counter\":0,"));
+}
+
+TEST(LogHistogram, KeepsEveryValueWithinOneSixteenth) {
+    for ( std::uint64_t value : { 0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 123456789ull, ~0ull } ) {
+        std::size_t bucket = CLogHistogram::bucketOf(value);
+        ASSERT_THAT(bucket, ::testing::Lt(CLogHistogram::BUCKETS));
+        ASSERT_THAT(CLogHistogram::lowerBound(bucket), ::testing::Le(value));
+        ASSERT_THAT(CLogHistogram::upperBound(bucket), ::testing::Ge(value));
+        ASSERT_THAT(CLogHistogram::upperBound(bucket) - CLogHistogram::lowerBound(bucket),
+                    ::testing::Le(CLogHistogram::lowerBound(bucket) / 16));
+    }
+
+    CLogHistogram histogram;
+    for ( std::uint64_t value = 1; value <= 1000; ++value ) {
+        histogram.add(value);
+    }
+    ASSERT_THAT(histogram.count(), ::testing::Eq(1000u));
+    ASSERT_THAT(histogram.percentile(50), ::testing::AllOf(::testing::Ge(500u), ::testing::Le(531u)));
+    ASSERT_THAT(histogram.percentile(100), ::testing::Eq(1000u));
+    ASSERT_THAT(histogram.mean(), ::testing::DoubleEq(500.5));
+}
+
 /* variable capture */
 
 std::vector<std::string> findAddressesWithName(CAddressBook const & addressBook, std::string strName) {
@@ -178,31 +207,18 @@ TEST(Lambda, for_each_loop_with_lambda) {
 
 #include <functional>
 
-/* Addressbook without template */
-class CAnotherAddressBook
-{
-    public:
-    std::vector<std::string> findMatchingAddresses (std::function<bool (const std::string&)> func)
-    {
-        std::vector<std::string> results;
-        for ( auto itr = m_strAddresses.begin(), end = m_strAddresses.end(); itr != end; ++itr )
-        {
-            // call the function passed into findMatchingAddresses and see if it matches
-            if ( func( *itr ) )
-            {
-                results.push_back( *itr );
-            }
-        }
-        return results;
-    }
+/* Addressbook without template: CAnotherAddressBook in include/AddressBook.h takes
+ * a std::function<bool (const std::string&)> */
 
-    void addAddress(std::string strAddress) {
-        m_strAddresses.emplace_back(strAddress);
-    }
-
-    private:
-    std::vector<std::string> m_strAddresses;
-};
+TEST(Function, AnotherAddressbookTakesAnyCallable) {
+    CAnotherAddressBook addressBook;
+    addressBook.addAddress("stefan.weigand@triagnosys.com");
+    addressBook.addAddress("somebody@some.org");
+    std::function<bool (const std::string&)> isOrg = [] (const std::string& addr) {
+        return addr.find( ".org" ) != std::string::npos;
+    };
+    ASSERT_THAT(addressBook.findMatchingAddresses(isOrg), ::testing::ElementsAre("somebody@some.org"));
+}
 
 TEST(Function, doWeHaveAFunction) {
     std::function<int ()> func;
@@ -39,22 +39,8 @@ TEST(Loops, basicRangeBasedLoop) {
 
 /* extended example */
 
-class CItem {
-public:
-   CItem(int cost) : cost_{cost} {}
-   int Cost() { return cost_; }
-private:
-   int cost_;
-};
-
-
-int TotalCost(std::vector<CItem>&& items) {
-   int total{0};
-   for (auto item: items) {
-       total += item.Cost();
-   }
-   return total;
-}
+/* class CItem and TotalCost (range based loop) are defined in include/TotalCost.h */
+#include "TotalCost.h"
 
 TEST(Loops, TotalCost) {
     ASSERT_THAT(
@@ -62,10 +48,7 @@ TEST(Loops, TotalCost) {
             ::testing::Eq(5 + 10 + 15));
 }
 
-int LambdaTotalCost(std::vector<CItem>&& items) {
-   return std::accumulate(items.begin(), items.end(), 0,
-     [] (int total, CItem item) { return total + item.Cost(); });
-}
+/* LambdaTotalCost (std::accumulate with a lambda) as well */
 
 TEST(Loops, LambdaTotalCost) {
     ASSERT_THAT(
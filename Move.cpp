@@ -15,67 +15,60 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <utility>
 #include <vector>
 
-/* use this class also to play with default and delete */
+/* class CMatrix (with copy and move constructor) is declared in include/Matrix.h */
+#include "Matrix.h"
 
-class CMatrix {
-public:
-    CMatrix(const CMatrix & matrix); // copy constructor
-//    CMatrix(CMatrix && matrix); // move constructor
-//    CMatrix& operator=(const CMatrix & matrix) = default; // copy assignment
-//    CMatrix& operator=(CMatrix && matrix); // move assignment (just to show)
-
-    CMatrix(std::size_t rows, std::size_t columns);
-    CMatrix & operator* (CMatrix const & other) const; // used for demonstrating copy
-//    CMatrix operator* (CMatrix const & other) const; // used for move
-
-    std::size_t rows() const;
-    std::size_t columns() const;
-    std::vector<double> elements() const;
+/* Motivation: swap */
 
-private:
-    std::size_t m_columns;
-    std::size_t m_rows;
-    std::vector<double> m_elements;
-};
+void swapMatrices(CMatrix& matrixA, CMatrix& matrixB) {
+    CMatrix matrixTmp(matrixA); // two copies A
+    matrixA = matrixB; // two copies B
+    matrixB = matrixTmp; // two copies Tmp
+}
 
-/* needed stuff */
-CMatrix::CMatrix(const CMatrix & matrix) :
-    m_columns(matrix.columns()),
-    m_rows(matrix.rows()),
-    m_elements(matrix.elements()) {}
+/* what the swap costs (see include/Tracing.h) */
 
-CMatrix::CMatrix(std::size_t rows, std::size_t columns) :
-        m_columns(columns),
-        m_rows(rows),
-        m_elements(std::vector<double>(rows*columns)) {}
+#include "TracingMatchers.h"
 
-std::size_t CMatrix::rows() const {
-    return m_rows;
-}
+TEST(Move, swapCopiesTheElements) {
+    CMatrix matrixA(2,5);
+    CMatrix matrixB(2,5);
 
-std::size_t CMatrix::columns() const {
-    return m_columns;
+    CTraceScope trace;
+    swapMatrices(matrixA, matrixB);
+    // a new buffer for matrixTmp; the assignments copy into the existing buffers
+    EXPECT_ALLOCATIONS(1);
+    EXPECT_ALLOCATED_BYTES(10 * sizeof(double));
 }
 
-std::vector<double> CMatrix::elements() const {
-    return m_elements;
+void moveSwapMatrices(CMatrix& matrixA, CMatrix& matrixB) {
+    CMatrix matrixTmp(std::move(matrixA)); // takes the elements of A
+    matrixA = std::move(matrixB);
+    matrixB = std::move(matrixTmp);
 }
 
+TEST(Move, swapWithMoveAllocatesNothing) {
+    CMatrix matrixA(2,5);
+    CMatrix matrixB(3,4);
 
+    CTraceScope trace;
+    moveSwapMatrices(matrixA, matrixB);
+    EXPECT_ALLOCATIONS(0);
 
-/* Motivation: swap */
-
-void swapMatrices(CMatrix& matrixA, CMatrix& matrixB) {
-    CMatrix matrixTmp(matrixA); // two copies A
-    matrixA = matrixB; // two copies B
-    matrixB = matrixTmp; // two copies Tmp
+    ASSERT_THAT(matrixA.rows(), ::testing::Eq(3u));
+    ASSERT_THAT(matrixB.elements().size(), ::testing::Eq(10u));
 }
 
 /* Motivation: multiply (possible mem leak (new without delete) */
+
+#include "Profiler.h"
+
 CMatrix & CMatrix::operator* (CMatrix const & other) const
 {
+    PROFILE_SCOPE("CMatrix::operator*");
     // snip: ... assert matrix sizes are compatible ...
     CMatrix * result = new CMatrix(rows(), other.columns());
     // snip: ... compute and store matrix elements ...
@@ -93,6 +86,33 @@ TEST(Move, matrixMemoryLeak) {
     // no fix for chained calls like A * (B * C)
 }
 
+/* every thread records into its own histogram, a snapshot merges them */
+
+#include <thread>
+
+TEST(Move, multiplyIsProfiledOnEveryThread) {
+    CProfiler & profiler = CProfiler::instance();
+    profiler.reset();
+    profiler.setEnabled(true);
+
+    std::vector<std::thread> vecThreads;
+    for ( int i = 0; i < 4; ++i ) {
+        vecThreads.push_back(std::thread([] () {
+            CMatrix matrixA(2,5);
+            CMatrix matrixB(5,2);
+            for ( int j = 0; j < 100; ++j ) {
+                delete (&(matrixA * matrixB));
+            }
+        } ));
+    }
+    for ( auto& thread : vecThreads ) {
+        thread.join();
+    }
+    profiler.setEnabled(false);
+
+    ASSERT_THAT(profiler.snapshot().find("CMatrix::operator*")->m_latency.count(), ::testing::Eq(400u));
+}
+
 /* with move constructor */
 
 //#include <utility>
@@ -105,14 +125,315 @@ TEST(Move, matrixMemoryLeak) {
 //    return std::move(result);
 //}
 //
-//CMatrix::CMatrix(CMatrix && matrix) :
-//    m_columns(matrix.columns()),
-//    m_rows(matrix.rows()),
-//    m_elements(std::move(matrix.elements())) {}
-//
 //TEST(Move, withMove) {
 //    CMatrix matrixA(2,5);
 //    CMatrix matrixB(2,5);
 //
 //    CMatrix matrixC = matrixA * matrixB;
 //}
+
+/* small matrices: shape in the type, elements inside the object
+ * (see include/FixedMatrix.h) */
+
+#include "FixedMatrix.h"
+
+static_assert(CFixedMatrix<2,5>::rows() == 2 && CFixedMatrix<2,5>::columns() == 5, "constexpr shape");
+static_assert(sizeof(CFixedMatrix<2,5>) == 10 * sizeof(double), "elements only");
+
+TEST(FixedMatrix, multipliesWithoutAllocating) {
+    const CFixedMatrix<2,5> matrixA{ 1, 2, 3, 4, 5,
+                                     6, 7, 8, 9, 10 };
+    const CFixedMatrix<2,5> matrixB{ 1, 0, 2, 0, 1,
+                                     0, 1, 0, 3, 1 };
+
+    CTraceScope trace;
+    CFixedMatrix<2,2> matrixC = matrixA * matrixB.transpose();
+    CFixedMatrix<5,5> matrixD = matrixA.transpose() * matrixB;
+    EXPECT_ALLOCATIONS(0);
+
+    ASSERT_THAT(matrixC, ::testing::Eq(CFixedMatrix<2,2>{ 12, 19, 32, 44 }));
+    ASSERT_THAT(matrixD(4,4), ::testing::Eq(5.0 + 10.0));
+    ASSERT_THAT(matrixD(0,1), ::testing::Eq(6.0));
+}
+
+TEST(FixedMatrix, invertsWithPivoting) {
+    const CFixedMatrix<3,3> matrix{ 0, 2, 1,
+                                    1, 1, 0,
+                                    3, 0, 1 };
+    const CFixedMatrix<3,3> product = matrix * matrix.inverse();
+    for ( std::size_t i = 0; i < 3; ++i ) {
+        for ( std::size_t j = 0; j < 3; ++j ) {
+            ASSERT_THAT(product(i,j), ::testing::DoubleNear(i == j ? 1.0 : 0.0, 1e-12));
+        }
+    }
+
+    const CFixedMatrix<2,2> singular{ 1, 2, 2, 4 };
+    ASSERT_THROW(singular.inverse(), std::domain_error);
+    // singular too, but rounding leaves a pivot of about 1e-16 instead of 0
+    const CFixedMatrix<3,3> rounded{ 0.1, 0.2, 0.3,
+                                     0.4, 0.5, 0.6,
+                                     0.7, 0.8, 0.9 };
+    ASSERT_THROW(rounded.inverse(), std::domain_error);
+    // small elements are no reason to give up, neither are mixed scales
+    const CFixedMatrix<2,2> scaled{ 1e-20, 0, 0, 2e-20 };
+    ASSERT_THAT(scaled.inverse()(1,1), ::testing::DoubleNear(0.5e20, 1e4));
+    const CFixedMatrix<2,2> mixed{ 1e10, 0, 0, 1e-10 };
+    ASSERT_THAT(mixed.inverse(), ::testing::Eq(CFixedMatrix<2,2>{ 1e-10, 0, 0, 1e10 }));
+    const CFixedMatrix<4,4> rowScaled{ 1e8, 2e8, 0, 0,
+                                       0, 1e-8, 3e-8, 0,
+                                       0, 0, 1, 1,
+                                       1e-9, 0, 0, 1e-9 };
+    const CFixedMatrix<4,4> rowScaledProduct = rowScaled.inverse() * rowScaled;
+    for ( std::size_t i = 0; i < 4; ++i ) {
+        for ( std::size_t j = 0; j < 4; ++j ) {
+            ASSERT_THAT(rowScaledProduct(i,j), ::testing::DoubleNear(i == j ? 1.0 : 0.0, 1e-9));
+        }
+    }
+}
+
+TEST(FixedMatrix, batchKernelsMatchSingleMatrices) {
+    CFixedMatrixBatch<3,4> batchA;
+    CFixedMatrixBatch<4,2> batchB;
+    for ( int n = 0; n < 100; ++n ) {
+        CFixedMatrix<3,4> matrixA;
+        CFixedMatrix<4,2> matrixB;
+        for ( std::size_t i = 0; i < matrixA.size(); ++i ) {
+            matrixA.data()[i] = n + 0.5 * i;
+        }
+        for ( std::size_t i = 0; i < matrixB.size(); ++i ) {
+            matrixB.data()[i] = n - 0.25 * i;
+        }
+        batchA.push_back(matrixA);
+        batchB.push_back(matrixB);
+    }
+
+    CFixedMatrixBatch<3,2> batchC;
+    multiply(batchA, batchB, batchC);
+    CFixedMatrixBatch<4,3> batchT;
+    transpose(batchA, batchT);
+    const CFixedMatrix<2,3> transform{ 1, 0, 0,
+                                       0, 0, 2 };
+    CFixedMatrixBatch<2,2> batchD;
+    multiply(transform, batchC, batchD);
+
+    ASSERT_THAT(batchC.size(), ::testing::Eq(100u));
+    for ( std::size_t n = 0; n < 100; ++n ) {
+        ASSERT_THAT(batchC.get(n), ::testing::Eq(batchA.get(n) * batchB.get(n)));
+        ASSERT_THAT(batchT.get(n), ::testing::Eq(batchA.get(n).transpose()));
+        ASSERT_THAT(batchD.get(n), ::testing::Eq(transform * batchC.get(n)));
+    }
+    ASSERT_THROW(multiply(batchA, CFixedMatrixBatch<4,2>(3), batchC), std::invalid_argument);
+}
+
+TEST(FixedMatrix, batchKernelsMayWriteIntoAnInput) {
+    CFixedMatrixBatch<2,2> batch;
+    for ( int n = 0; n < 20; ++n ) {
+        batch.push_back(CFixedMatrix<2,2>{ 1.0 * n, 1, 2, 3 });
+    }
+    const CFixedMatrixBatch<2,2> original(batch);
+    const CFixedMatrix<2,2> transform{ 0, 1, 1, 0 };
+
+    multiply(batch, original, batch);
+    for ( std::size_t n = 0; n < 20; ++n ) {
+        ASSERT_THAT(batch.get(n), ::testing::Eq(original.get(n) * original.get(n)));
+    }
+    batch = original;
+    multiply(original, batch, batch);
+    multiply(transform, batch, batch);
+    transpose(batch, batch);
+    for ( std::size_t n = 0; n < 20; ++n ) {
+        ASSERT_THAT(batch.get(n), ::testing::Eq((transform * (original.get(n) * original.get(n))).transpose()));
+    }
+}
+
+/* large matrices: a real multiply and the solvers built on it
+ * (see include/TiledMultiply.h and include/MatrixFactorization.h) */
+
+#include "MatrixFactorization.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+static CMatrix randomMatrix(std::size_t rows, std::size_t columns, unsigned int seed) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+    CMatrix result(rows, columns);
+    for ( std::size_t i = 0; i < rows * columns; ++i ) {
+        result.data()[i] = distribution(generator);
+    }
+    return result;
+}
+
+// M M^T + n I
+static CMatrix positiveDefiniteMatrix(std::size_t n, unsigned int seed) {
+    const CMatrix matrix = randomMatrix(n, n, seed);
+    CMatrix transposed(n, n);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        for ( std::size_t j = 0; j < n; ++j ) {
+            transposed(j, i) = matrix(i, j);
+        }
+    }
+    CMatrix result = multiply(matrix, transposed);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        result(i, i) += n;
+    }
+    return result;
+}
+
+static double maxDifference(const CMatrix & matrixA, const CMatrix & matrixB) {
+    double result = 0.0;
+    for ( std::size_t i = 0; i < matrixA.rows() * matrixA.columns(); ++i ) {
+        result = std::max(result, std::abs(matrixA.data()[i] - matrixB.data()[i]));
+    }
+    return result;
+}
+
+TEST(TiledMultiply, matchesTheTextbookLoop) {
+    // not multiples of the 4 x 4 kernel nor of the tiles
+    const CMatrix matrixA = randomMatrix(37, 301, 1);
+    const CMatrix matrixB = randomMatrix(301, 263, 2);
+
+    CMatrix expected(37, 263);
+    for ( std::size_t i = 0; i < 37; ++i ) {
+        for ( std::size_t k = 0; k < 301; ++k ) {
+            for ( std::size_t j = 0; j < 263; ++j ) {
+                expected(i, j) += matrixA(i, k) * matrixB(k, j);
+            }
+        }
+    }
+    ASSERT_THAT(maxDifference(multiply(matrixA, matrixB), expected), ::testing::Lt(1e-12));
+    ASSERT_THROW(multiply(matrixA, matrixA), std::invalid_argument);
+}
+
+TEST(TiledMultiply, parallelBlocksRunsEveryBlockOnce) {
+    std::vector<std::atomic<int>> vecCalls(1000);
+    auto count = [&vecCalls] (std::size_t block) { ++vecCalls[block]; };
+
+    // a second caller and nested calls find the threads busy and run serially
+    std::thread other([&count] () {
+        for ( int i = 0; i < 20; ++i ) {
+            parallelBlocks(500, count);
+        }
+    } );
+    for ( int i = 0; i < 20; ++i ) {
+        parallelBlocks(10, [&count] (std::size_t block) {
+            parallelBlocks(50, [&count, block] (std::size_t inner) { count(500 + 50 * block + inner); });
+        } );
+    }
+    other.join();
+
+    for ( auto& calls : vecCalls ) {
+        ASSERT_THAT(calls.load(), ::testing::Eq(20));
+    }
+}
+
+TEST(TiledMultiply, parallelBlocksPassesExceptionsOn) {
+    // every block throws: on the calling thread and on the workers, if there are any
+    for ( int i = 0; i < 3; ++i ) {
+        ASSERT_THROW(parallelBlocks(100, [] (std::size_t block) {
+            throw std::out_of_range("block " + std::to_string(block));
+        } ), std::out_of_range);
+    }
+    // the threads are free again afterwards, no run is left serial
+    std::mutex mutex;
+    std::set<std::thread::id> setThreads;
+    parallelBlocks(100, [&mutex, &setThreads] (std::size_t) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        std::lock_guard<std::mutex> lock(mutex);
+        setThreads.insert(std::this_thread::get_id());
+    } );
+    ASSERT_THAT(setThreads.size(), ::testing::Eq(CBlockThreads::instance().size()));
+}
+
+TEST(LuFactorization, solvesManyRightHandSides) {
+    const std::size_t n = 150;
+    const CMatrix matrix = randomMatrix(n, n, 3);
+    const CMatrix vectors = randomMatrix(n, 7, 4);
+
+    // 5 blocks, the last one smaller
+    const CLuFactorization lu(matrix, 32);
+    const CMatrix solutions = lu.solve(vectors);
+    ASSERT_THAT(maxDifference(multiply(matrix, solutions), vectors), ::testing::Lt(1e-10));
+
+    const std::vector<double> vecSolution = lu.solve(std::vector<double>(n, 1.0));
+    for ( std::size_t i = 0; i < n; ++i ) {
+        double sum = 0.0;
+        for ( std::size_t j = 0; j < n; ++j ) {
+            sum += matrix(i, j) * vecSolution[j];
+        }
+        ASSERT_THAT(sum, ::testing::DoubleNear(1.0, 1e-10));
+    }
+
+    const CLuFactorization unblocked(matrix, n);
+    ASSERT_THAT(maxDifference(unblocked.solve(vectors), solutions), ::testing::Lt(1e-10));
+    ASSERT_THAT(unblocked.logAbsDeterminant(), ::testing::DoubleNear(lu.logAbsDeterminant(), 1e-9));
+    ASSERT_THAT(unblocked.determinantSign(), ::testing::Eq(lu.determinantSign()));
+}
+
+TEST(LuFactorization, pivotsAndInverts) {
+    CMatrix matrix(3, 3);
+    const double elements[] = { 0, 2, 1,
+                                1, 1, 0,
+                                3, 0, 1 };
+    std::copy(elements, elements + 9, matrix.data());
+
+    const CLuFactorization lu(matrix, 2);
+    ASSERT_THAT(lu.determinant(), ::testing::DoubleNear(-5.0, 1e-12));
+    ASSERT_THAT(lu.logAbsDeterminant(), ::testing::DoubleNear(std::log(5.0), 1e-12));
+    ASSERT_THAT(lu.determinantSign(), ::testing::Eq(-1));
+    CMatrix identity(3, 3);
+    for ( std::size_t i = 0; i < 3; ++i ) {
+        identity(i, i) = 1.0;
+    }
+    ASSERT_THAT(maxDifference(multiply(matrix, lu.inverse()), identity), ::testing::Lt(1e-12));
+
+    CMatrix singular(2, 2);
+    singular(0, 0) = 1; singular(0, 1) = 2;
+    singular(1, 0) = 2; singular(1, 1) = 4;
+    ASSERT_THROW(CLuFactorization lu(singular), std::domain_error);
+    // singular too, but rounding leaves a pivot of about 1e-16 instead of 0
+    CMatrix rounded(3, 3);
+    for ( std::size_t i = 0; i < 9; ++i ) {
+        rounded.data()[i] = 0.1 * (i + 1);
+    }
+    ASSERT_THROW(CLuFactorization lu(rounded, 2), std::domain_error);
+    CMatrix mixed(2, 2);
+    mixed(0, 0) = 1e10; mixed(1, 1) = 1e-10;
+    ASSERT_THAT(CLuFactorization(mixed).determinant(), ::testing::DoubleNear(1.0, 1e-12));
+    ASSERT_THROW(CLuFactorization lu(CMatrix(2, 3)), std::invalid_argument);
+    ASSERT_THROW(lu.solve(std::vector<double>(2)), std::invalid_argument);
+}
+
+TEST(CholeskyFactorization, agreesWithLu) {
+    const std::size_t n = 150;
+    const CMatrix matrix = positiveDefiniteMatrix(n, 5);
+    const CMatrix vectors = randomMatrix(n, 7, 6);
+
+    const CCholeskyFactorization cholesky(matrix, 32);
+    const CMatrix solutions = cholesky.solve(vectors);
+    ASSERT_THAT(maxDifference(multiply(matrix, solutions), vectors), ::testing::Lt(1e-10));
+
+    // the determinant itself is far beyond the range of double
+    const CLuFactorization lu(matrix);
+    ASSERT_THAT(cholesky.logDeterminant(), ::testing::DoubleNear(lu.logAbsDeterminant(), 1e-9));
+    ASSERT_THAT(lu.determinantSign(), ::testing::Eq(1));
+    ASSERT_THAT(maxDifference(cholesky.inverse(), lu.inverse()), ::testing::Lt(1e-12));
+
+    const CCholeskyFactorization unblocked(matrix, n);
+    ASSERT_THAT(maxDifference(unblocked.solve(vectors), solutions), ::testing::Lt(1e-12));
+
+    CMatrix small(2, 2);
+    small(0, 0) = 4; small(0, 1) = 2;
+    small(1, 0) = 2; small(1, 1) = 3;
+    ASSERT_THAT(CCholeskyFactorization(small).determinant(), ::testing::DoubleNear(8.0, 1e-12));
+    ASSERT_THAT(CLuFactorization(small).determinant(), ::testing::DoubleNear(8.0, 1e-12));
+
+    CMatrix indefinite(2, 2);
+    indefinite(0, 0) = 1; indefinite(1, 0) = 2; indefinite(1, 1) = 1;
+    ASSERT_THROW(CCholeskyFactorization cholesky(indefinite), std::domain_error);
+}
@@ -12,16 +12,21 @@
  */
 /*---------------------------------------------------------------------------*/
 
+#include "TracingMatchers.h"
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <string>
+#include <utility>
 
 using namespace std;
 
 vector<int> doubleValues (const vector<int>& v)
 {
-    vector<int> new_values( v.size() );
-    for (auto itr = new_values.begin(), end_itr = new_values.end(); itr != end_itr; ++itr )
+    vector<int> new_values;
+    new_values.reserve( v.size() );
+    for (auto itr = v.begin(), end_itr = v.end(); itr != end_itr; ++itr )
     {
         new_values.push_back( 2 * *itr );
     }
@@ -35,6 +40,82 @@ TEST(ManyCopies, copyValues) {
     {
         v.push_back( i );
     }
+
+    CTraceScope trace;
     v = doubleValues( v ); // copy
+    // no: the one allocation is new_values, returning and assigning it move
+    EXPECT_ALLOCATIONS(1);
+    EXPECT_ALLOCATED_BYTES(100 * sizeof(int));
+    ASSERT_THAT(v.size(), ::testing::Eq(100u));
+    ASSERT_THAT(v[99], ::testing::Eq(198));
+}
+
+
+/* count them (see include/Tracing.h) */
+
+typedef CTracked<std::vector<int>> TrackedValues;
+
+TrackedValues byValue(TrackedValues values) {
+    return values; // moved out (parameters are never elided)
 }
 
+const TrackedValues & byReference(const TrackedValues & values) {
+    return values;
+}
+
+TEST(ManyCopies, countsCopiesAndMoves) {
+    TrackedValues values(std::vector<int>(100, 1));
+
+    CTraceScope trace;
+    TrackedValues copy = byValue(values);  // copy into the parameter, move out
+    EXPECT_COPIES(1);
+    EXPECT_MOVES(1);
+
+    trace.reset();
+    TrackedValues moved = byValue(std::move(copy));  // no copy at all
+    EXPECT_COPIES(0);
+    EXPECT_MOVES(2);
+    EXPECT_ALLOCATIONS(0);
+
+    trace.reset();
+    std::size_t size = byReference(moved).get().size();
+    const CTraceCounters counters = trace.counters();
+    EXPECT_THAT(counters, ::testing::AllOf(HasCopies(0), HasMoves(0), HasAllocations(0)));
+    ASSERT_THAT(size, ::testing::Eq(100u));
+}
+
+TEST(ManyCopies, countsAllocationsOfACopy) {
+    std::vector<int> v(100);
+
+    CTraceScope trace;
+    std::vector<int> copy(v);
+    EXPECT_ALLOCATIONS(1);
+    EXPECT_ALLOCATED_BYTES(100 * sizeof(int));
+
+    {
+        CTraceScope inner;
+        std::vector<int> moved(std::move(copy));
+        EXPECT_ALLOCATIONS(0);  // checks the innermost scope
+    }
+    EXPECT_ALLOCATIONS(1);
+}
+
+TEST(ManyCopies, growingVectorMovesElements) {
+    std::vector<TrackedValues> vecValues;
+
+    CTraceScope trace;
+    for ( int i = 0; i < 4; ++i ) {
+        vecValues.push_back(TrackedValues(std::vector<int>(10, i)));
+    }
+    // growing moves the elements, std::vector's move constructor is noexcept
+    EXPECT_COPIES(0);
+    EXPECT_MOVES(::testing::Gt(4u));
+
+    trace.reset();
+    std::vector<TrackedValues> vecReserved;
+    vecReserved.reserve(4);
+    for ( int i = 0; i < 4; ++i ) {
+        vecReserved.emplace_back(std::vector<int>(10, i));
+    }
+    EXPECT_MOVES(0);
+}
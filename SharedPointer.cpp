@@ -17,18 +17,8 @@
 
 #include <memory>
 
-/* a custom demo class
- */
-class CFancyWindow {
-public:
-    CFancyWindow(int iWidth, int iHeight) {
-        // some construction stuff
-    }
-
-    void maximize() {
-        // some code to maximize the window
-    }
-};
+/* a custom demo class: CFancyWindow in include/FancyWindow.h */
+#include "FancyWindow.h"
 
 TEST(SharedPointer, HasAPointerAndCount) {
     auto window = std::make_shared<CFancyWindow>(600, 400);
@@ -45,3 +35,148 @@ TEST(SharedPointer, HasAPointerAndCount) {
 }
 
 
+
+/* publishing a read-mostly configuration to many threads:
+ * guarding a shared_ptr with a mutex serializes all readers. CAtomicSharedPtr
+ * lets readers take a handle without lock and without touching the reference
+ * count (see include/AtomicSharedPtr.h).
+ */
+
+#include "AtomicSharedPtr.h"
+#include "TracingMatchers.h"
+
+#include <thread>
+#include <vector>
+
+TEST(AtomicSharedPointer, ReadsPublishedValue) {
+    CAtomicSharedPtr<const CFancyWindow> config(std::make_shared<const CFancyWindow>(600, 400));
+
+    auto handle = config.read();
+    ASSERT_THAT(handle->width(), ::testing::Eq(600));
+    ASSERT_THAT(handle->height(), ::testing::Eq(400));
+
+    config.store(std::make_shared<const CFancyWindow>(800, 600));
+    ASSERT_THAT(config.read()->width(), ::testing::Eq(800));
+    // the old window stays alive as long as a reader holds it
+    ASSERT_THAT(handle->width(), ::testing::Eq(600));
+    ASSERT_THAT(config.retiredCount(), ::testing::Eq(1u));
+}
+
+TEST(AtomicSharedPointer, FreesOldValueWhenLastReaderIsGone) {
+    std::weak_ptr<const CFancyWindow> old;
+    CAtomicSharedPtr<const CFancyWindow> config;
+    {
+        auto window = std::make_shared<const CFancyWindow>(600, 400);
+        old = window;
+        config.store(window);
+    }
+    {
+        auto handle = config.read();
+        config.store(std::make_shared<const CFancyWindow>(800, 600));
+        config.store(std::make_shared<const CFancyWindow>(1024, 768));
+        ASSERT_FALSE(old.expired());
+    }
+    config.store(std::make_shared<const CFancyWindow>(1280, 1024));
+    ASSERT_TRUE(old.expired());
+    ASSERT_THAT(config.retiredCount(), ::testing::Eq(0u));
+}
+
+TEST(AtomicSharedPointer, LoadReturnsSharedPointer) {
+    CAtomicSharedPtr<const CFancyWindow> config(std::make_shared<const CFancyWindow>(600, 400));
+
+    std::shared_ptr<const CFancyWindow> window = config.load();
+    config.store(std::make_shared<const CFancyWindow>(800, 600));
+
+    ASSERT_THAT(window->width(), ::testing::Eq(600));
+    ASSERT_THAT(window.use_count(), ::testing::Eq(1));
+}
+
+TEST(AtomicSharedPointer, ReadsWithoutAllocating) {
+    CAtomicSharedPtr<const CFancyWindow> config(std::make_shared<const CFancyWindow>(600, 400));
+    config.read();  // the first read of a thread registers it with the hazard domain
+
+    CTraceScope trace;
+    int sum = 0;
+    for ( int i = 0; i < 1000; ++i ) {
+        sum += config.read()->width();
+    }
+    EXPECT_ALLOCATIONS(0);
+    ASSERT_THAT(sum, ::testing::Eq(600000));
+}
+
+TEST(AtomicSharedPointer, FallsBackWhenOutOfHazardSlots) {
+    CAtomicSharedPtr<const CFancyWindow> config(std::make_shared<const CFancyWindow>(600, 400));
+
+    std::vector<CAtomicSharedPtr<const CFancyWindow>::CReadHandle> vecHandles;
+    for ( std::size_t i = 0; i < CHazardDomain::SLOTS_PER_THREAD + 2; ++i ) {
+        vecHandles.push_back(config.read());
+    }
+    for ( auto& handle : vecHandles ) {
+        ASSERT_THAT(handle->width(), ::testing::Eq(600));
+    }
+}
+
+TEST(AtomicSharedPointer, HandlesMayBeReleasedOnAnotherThread) {
+    typedef CAtomicSharedPtr<const CFancyWindow> Config;
+    Config config(std::make_shared<const CFancyWindow>(600, 400));
+
+    // all slots of this thread, released by another one
+    std::vector<Config::CReadHandle> vecHandles;
+    for ( std::size_t i = 0; i < CHazardDomain::SLOTS_PER_THREAD; ++i ) {
+        vecHandles.push_back(config.read());
+    }
+    std::thread([&vecHandles] () { vecHandles.clear(); } ).join();
+
+    // so this read gets a slot again and protects the old value
+    {
+        auto handle = config.read();
+        config.store(std::make_shared<const CFancyWindow>(800, 600));
+        ASSERT_THAT(config.retiredCount(), ::testing::Eq(1u));
+        ASSERT_THAT(handle->width(), ::testing::Eq(600));
+    }
+
+    // a handle outliving the thread which read it still protects its value
+    std::vector<Config::CReadHandle> vecOrphans;
+    std::thread([&vecOrphans, &config] () { vecOrphans.push_back(config.read()); } ).join();
+    config.store(std::make_shared<const CFancyWindow>(1024, 768));
+    ASSERT_THAT(config.retiredCount(), ::testing::Eq(1u));
+    ASSERT_THAT(vecOrphans[0]->width(), ::testing::Eq(800));
+    vecOrphans.clear();
+    config.store(std::make_shared<const CFancyWindow>(1280, 1024));
+    ASSERT_THAT(config.retiredCount(), ::testing::Eq(0u));
+}
+
+/* stress test: run the binary built with -fsanitize=thread to let TSAN check it
+ *   --gtest_filter=AtomicSharedPointer.*
+ */
+TEST(AtomicSharedPointer, StressManyReadersOneUpdater) {
+    CAtomicSharedPtr<const CFancyWindow> config(std::make_shared<const CFancyWindow>(2, 1));
+    std::atomic<bool> bDone{false};
+    std::atomic<int> iBroken{0};
+
+    std::vector<std::thread> vecReaders;
+    for ( int i = 0; i < 4; ++i ) {
+        vecReaders.emplace_back([&] () {
+            while ( !bDone.load() ) {
+                auto handle = config.read();
+                if ( handle->width() != 2 * handle->height() ) {
+                    ++iBroken;
+                }
+                if ( config.load()->width() % 2 != 0 ) {
+                    ++iBroken;
+                }
+            }
+        } );
+    }
+
+    for ( int i = 1; i <= 20000; ++i ) {
+        config.store(std::make_shared<const CFancyWindow>(2 * i, i));
+    }
+    bDone = true;
+    for ( auto& reader : vecReaders ) {
+        reader.join();
+    }
+
+    ASSERT_THAT(iBroken.load(), ::testing::Eq(0));
+    ASSERT_THAT(config.read()->height(), ::testing::Eq(20000));
+}
@@ -0,0 +1,109 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for AutoAndDecltypeBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+#include "BuilderPipeline.h"
+#include "PersonTable.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+/* builder pipeline vs hand written code, bit packed person types vs one
+ * enum per person (see AutoAndDecltype.cpp)
+ *
+ * Both pipeline benchmarks should compile to the same loop:
+ *   make AutoAndDecltypeBenchmark.s
+ * that the pipeline folds is checked automatically by asmcheck/PipelineFold.cpp
+ */
+
+namespace {
+
+struct CValueBuilder {
+    int makeObject() const {
+        return m_iValue;
+    }
+
+    int m_iValue;
+};
+
+struct AddOne {
+    int operator() (int value) const {
+        return value + 1;
+    }
+};
+
+struct Square {
+    long operator() (int value) const {
+        return static_cast<long>(value) * value;
+    }
+};
+
+} // namespace
+
+static void PipelineOperator(benchmark::State & state) {
+    CValueBuilder builder = { 6 };
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(builder.m_iValue);
+        auto pipeline = builder | AddOne() | Square();
+        benchmark::DoNotOptimize(pipeline.makeObject());
+    }
+}
+BENCHMARK(PipelineOperator);
+
+static void PipelineHandWritten(benchmark::State & state) {
+    CValueBuilder builder = { 6 };
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(builder.m_iValue);
+        int value = builder.makeObject() + 1;
+        benchmark::DoNotOptimize(static_cast<long>(value) * value);
+    }
+}
+BENCHMARK(PipelineHandWritten);
+
+
+static void PersonTypesCountPacked(benchmark::State & state) {
+    const std::size_t size = static_cast<std::size_t>(state.range(0));
+    CPersonTable table(size);
+    for ( std::size_t i = 0; i < size; i += 3 ) {
+        table.setPersonType(i, Person::CHILD);
+    }
+
+    for ( auto _ : state ) {
+        CPersonTable::Histogram histogram = table.countByType();
+        benchmark::DoNotOptimize(histogram.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(PersonTypesCountPacked)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->UseRealTime();
+
+static void PersonTypesCountEnums(benchmark::State & state) {
+    const std::size_t size = static_cast<std::size_t>(state.range(0));
+    std::vector<Person::PersonType> vecTypes(size, Person::ADULT);
+    for ( std::size_t i = 0; i < size; i += 3 ) {
+        vecTypes[i] = Person::CHILD;
+    }
+
+    for ( auto _ : state ) {
+        std::array<std::size_t, 3> histogram = {{ 0, 0, 0 }};
+        for ( auto type : vecTypes ) {
+            ++histogram[type];
+        }
+        benchmark::DoNotOptimize(histogram.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(PersonTypesCountEnums)->RangeMultiplier(16)->Range(1 << 12, 1 << 24)->UseRealTime();
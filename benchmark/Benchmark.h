@@ -0,0 +1,29 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for Benchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "Tracing.h"
+
+#include <benchmark/benchmark.h>
+
+/* reports the allocations of the benchmark loop (counted by src/Tracing.cpp)
+ * as "allocs/iter", which compare.py checks as well */
+inline void reportAllocations(benchmark::State & state, const CTraceScope & trace) {
+    state.counters["allocs/iter"] = benchmark::Counter(
+            static_cast<double>(trace.allocations()), benchmark::Counter::kAvgIterations);
+}
+
+#endif /* BENCHMARK_H_ */
@@ -0,0 +1,231 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for BraceInitializationBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+#include "FlatHashMap.h"
+#include "PerfectHashTable.h"
+#include "ScoreBoard.h"
+#include "SortedFlatMap.h"
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* the containers of BraceInitialization.cpp: flat maps against the standard
+ * maps, the compile time grade table against std::map and a switch, and
+ * score board ingest */
+
+namespace {
+
+std::vector<std::string> makeNames(std::size_t size) {
+    std::vector<std::string> vecNames;
+    vecNames.reserve(size);
+    for ( std::size_t i = 0; i < size; ++i ) {
+        vecNames.push_back("person" + std::to_string(i * 7919));
+    }
+    return vecNames;
+}
+
+// lookups in a different order than insertion, half of them misses
+std::vector<std::string> makeQueries(const std::vector<std::string> & vecNames) {
+    std::vector<std::string> vecQueries;
+    for ( std::size_t i = 0; i < vecNames.size(); ++i ) {
+        vecQueries.push_back(i % 2 ? vecNames[(i * 31) % vecNames.size()] : "nobody" + std::to_string(i));
+    }
+    return vecQueries;
+}
+
+template <typename Map>
+void fillMap(Map & map, const std::vector<std::string> & vecNames) {
+    for ( auto& name : vecNames ) {
+        map[name] = static_cast<unsigned int>(name.size());
+    }
+}
+
+// one sort instead of 10^7 inserts into the middle of a vector
+void fillMap(CSortedFlatMap<std::string, unsigned int> & map, const std::vector<std::string> & vecNames) {
+    std::vector<std::pair<std::string, unsigned int>> vecEntries;
+    vecEntries.reserve(vecNames.size());
+    for ( auto& name : vecNames ) {
+        vecEntries.emplace_back(name, static_cast<unsigned int>(name.size()));
+    }
+    map.insert(vecEntries.begin(), vecEntries.end());
+}
+
+template <typename Map>
+void mapFind(benchmark::State & state) {
+    const std::vector<std::string> vecNames = makeNames(static_cast<std::size_t>(state.range(0)));
+    const std::vector<std::string> vecQueries = makeQueries(vecNames);
+    Map map;
+    fillMap(map, vecNames);
+
+    for ( auto _ : state ) {
+        std::size_t found = 0;
+        for ( auto& query : vecQueries ) {
+            found += map.find(query) != map.end();
+        }
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations() * vecQueries.size());
+}
+
+template <typename Map>
+void mapInsert(benchmark::State & state) {
+    const std::vector<std::string> vecNames = makeNames(static_cast<std::size_t>(state.range(0)));
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        Map map;
+        fillMap(map, vecNames);
+        benchmark::DoNotOptimize(&map);
+    }
+    reportAllocations(state, trace);
+    state.SetItemsProcessed(state.iterations() * vecNames.size());
+}
+
+template <typename Map>
+void mapIterate(benchmark::State & state) {
+    const std::vector<std::string> vecNames = makeNames(static_cast<std::size_t>(state.range(0)));
+    Map map;
+    fillMap(map, vecNames);
+
+    for ( auto _ : state ) {
+        unsigned int sum = 0;
+        for ( auto& entry : map ) {
+            sum += entry.second;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * vecNames.size());
+}
+
+typedef std::map<std::string, unsigned int> StdMap;
+typedef std::unordered_map<std::string, unsigned int> StdUnorderedMap;
+typedef CFlatHashMap<std::string, unsigned int> FlatHashMap;
+typedef CSortedFlatMap<std::string, unsigned int> SortedFlatMap;
+
+} // namespace
+
+/* 10^3 keys fit into L1/L2, 10^7 keys (about 1 GB with the strings) are far
+ * beyond the L3 cache: there every lookup is a cache miss per probe */
+BENCHMARK_TEMPLATE(mapFind, StdMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapFind, StdUnorderedMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapFind, FlatHashMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapFind, SortedFlatMap)->RangeMultiplier(10)->Range(1000, 10000000);
+
+BENCHMARK_TEMPLATE(mapInsert, StdMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapInsert, StdUnorderedMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapInsert, FlatHashMap)->RangeMultiplier(10)->Range(1000, 10000000);
+
+BENCHMARK_TEMPLATE(mapIterate, StdMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapIterate, StdUnorderedMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapIterate, FlatHashMap)->RangeMultiplier(10)->Range(1000, 10000000);
+BENCHMARK_TEMPLATE(mapIterate, SortedFlatMap)->RangeMultiplier(10)->Range(1000, 10000000);
+
+
+/* grade points: fixed keys */
+
+namespace {
+
+constexpr auto gradePoints = makePerfectHashTable<int>({
+    {"A", 4}, {"B", 3}, {"C", 2}, {"D", 1}, {"F", 0}
+});
+
+const std::map<std::string, int> mapGradePoints = {
+    {"A", 4}, {"B", 3}, {"C", 2}, {"D", 1}, {"F", 0}
+};
+
+int switchGradePoints(CStringRef grade) {
+    if ( grade.size() != 1 ) {
+        return -1;
+    }
+    switch ( grade.data()[0] ) {
+    case 'A': return 4;
+    case 'B': return 3;
+    case 'C': return 2;
+    case 'D': return 1;
+    case 'F': return 0;
+    default: return -1;
+    }
+}
+
+const char * const grades[] = { "B", "F", "A", "E", "C", "D", "AB", "A" };
+
+} // namespace
+
+static void GradePointsPerfectHash(benchmark::State & state) {
+    for ( auto _ : state ) {
+        int sum = 0;
+        for ( auto pGrade : grades ) {
+            benchmark::DoNotOptimize(pGrade);
+            const int * pPoints = gradePoints.find(pGrade);
+            sum += pPoints ? *pPoints : -1;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(GradePointsPerfectHash);
+
+static void GradePointsStdMap(benchmark::State & state) {
+    for ( auto _ : state ) {
+        int sum = 0;
+        for ( auto pGrade : grades ) {
+            benchmark::DoNotOptimize(pGrade);
+            auto itr = mapGradePoints.find(pGrade);
+            sum += itr != mapGradePoints.end() ? itr->second : -1;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(GradePointsStdMap);
+
+static void GradePointsSwitch(benchmark::State & state) {
+    for ( auto _ : state ) {
+        int sum = 0;
+        for ( auto pGrade : grades ) {
+            benchmark::DoNotOptimize(pGrade);
+            sum += switchGradePoints(pGrade);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+BENCHMARK(GradePointsSwitch);
+
+
+/* score board ingest: 1000 distinct students */
+
+static void ScoreBoardIngest(benchmark::State & state) {
+    const std::size_t scores = static_cast<std::size_t>(state.range(0));
+    const std::vector<std::string> vecNames = makeNames(1000);
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        CScoreBoard board(10);
+        board.reserve(scores, vecNames.size());
+        for ( std::size_t i = 0; i < scores; ++i ) {
+            board.addStudentScore(vecNames[i % vecNames.size()], static_cast<int>(i * 37 % 101));
+        }
+        benchmark::DoNotOptimize(board.percentile(50));
+    }
+    reportAllocations(state, trace);
+    // comparable across batch sizes, unlike allocs/iter (one whole batch)
+    state.counters["allocs/score"] = benchmark::Counter(
+            static_cast<double>(trace.allocations()) / scores, benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * scores);
+}
+BENCHMARK(ScoreBoardIngest)->RangeMultiplier(10)->Range(1000, 1000000);
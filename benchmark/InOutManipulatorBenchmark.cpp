@@ -0,0 +1,102 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for InOutManipulatorBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* hex -> oct conversion of InOutManipulator.cpp with streams and without */
+
+namespace {
+
+std::vector<std::string> makeHexNumbers() {
+    std::vector<std::string> vecHex;
+    for ( unsigned long i = 0; i < 1024; ++i ) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%lX", i * 2654435761ul % 0xFFFFFFul);
+        vecHex.push_back(buffer);
+    }
+    return vecHex;
+}
+
+} // namespace
+
+// a new stringstream per conversion, as in the test
+static void RadixStringStream(benchmark::State & state) {
+    const std::vector<std::string> vecHex = makeHexNumbers();
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        for ( auto& strHex : vecHex ) {
+            std::stringstream ssHex(strHex);
+            unsigned long ulDec;
+            ssHex >> std::hex >> ulDec;
+            std::stringstream ssOct;
+            ssOct << std::oct << ulDec;
+            std::string strOct = ssOct.str();
+            benchmark::DoNotOptimize(strOct.data());
+        }
+    }
+    reportAllocations(state, trace);
+    state.SetItemsProcessed(state.iterations() * vecHex.size());
+}
+BENCHMARK(RadixStringStream);
+
+// one pair of streams, reset for every conversion
+static void RadixStringStreamReused(benchmark::State & state) {
+    const std::vector<std::string> vecHex = makeHexNumbers();
+    std::stringstream ssHex;
+    std::stringstream ssOct;
+    ssOct << std::oct;
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        for ( auto& strHex : vecHex ) {
+            ssHex.clear();
+            ssHex.str(strHex);
+            unsigned long ulDec;
+            ssHex >> std::hex >> ulDec;
+            ssOct.str(std::string());
+            ssOct << ulDec;
+            std::string strOct = ssOct.str();
+            benchmark::DoNotOptimize(strOct.data());
+        }
+    }
+    reportAllocations(state, trace);
+    state.SetItemsProcessed(state.iterations() * vecHex.size());
+}
+BENCHMARK(RadixStringStreamReused);
+
+static void RadixStrtoul(benchmark::State & state) {
+    const std::vector<std::string> vecHex = makeHexNumbers();
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        for ( auto& strHex : vecHex ) {
+            unsigned long ulDec = std::strtoul(strHex.c_str(), nullptr, 16);
+            char buffer[32];
+            int length = std::snprintf(buffer, sizeof(buffer), "%lo", ulDec);
+            benchmark::DoNotOptimize(buffer);
+            benchmark::DoNotOptimize(length);
+        }
+    }
+    reportAllocations(state, trace);
+    state.SetItemsProcessed(state.iterations() * vecHex.size());
+}
+BENCHMARK(RadixStrtoul);
@@ -0,0 +1,76 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for LambdaBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "AddressBook.h"
+#include "Benchmark.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/* template vs std::function in the address books (see Lambda.cpp) */
+
+namespace {
+
+// every 10th address is an .org one
+template <typename AddressBook>
+AddressBook makeAddressBook(std::size_t size) {
+    AddressBook addressBook;
+    for ( std::size_t i = 0; i < size; ++i ) {
+        addressBook.addAddress("person" + std::to_string(i) + (i % 10 ? "@some.com" : "@some.org"));
+    }
+    return addressBook;
+}
+
+bool isOrg(const std::string & addr) {
+    return addr.find( ".org" ) != std::string::npos;
+}
+
+} // namespace
+
+static void AddressBookTemplateLambda(benchmark::State & state) {
+    const CAddressBook addressBook = makeAddressBook<CAddressBook>(static_cast<std::size_t>(state.range(0)));
+
+    for ( auto _ : state ) {
+        std::vector<std::string> vecResults = addressBook.findMatchingAddresses(
+                [] (const std::string & addr) { return addr.find( ".org" ) != std::string::npos; } );
+        benchmark::DoNotOptimize(vecResults.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(AddressBookTemplateLambda)->RangeMultiplier(8)->Range(64, 32768);
+
+static void AddressBookTemplateFunctionPointer(benchmark::State & state) {
+    const CAddressBook addressBook = makeAddressBook<CAddressBook>(static_cast<std::size_t>(state.range(0)));
+
+    for ( auto _ : state ) {
+        std::vector<std::string> vecResults = addressBook.findMatchingAddresses(&isOrg);
+        benchmark::DoNotOptimize(vecResults.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(AddressBookTemplateFunctionPointer)->RangeMultiplier(8)->Range(64, 32768);
+
+static void AddressBookStdFunction(benchmark::State & state) {
+    CAnotherAddressBook addressBook = makeAddressBook<CAnotherAddressBook>(static_cast<std::size_t>(state.range(0)));
+
+    for ( auto _ : state ) {
+        std::vector<std::string> vecResults = addressBook.findMatchingAddresses(
+                [] (const std::string & addr) { return addr.find( ".org" ) != std::string::npos; } );
+        benchmark::DoNotOptimize(vecResults.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(AddressBookStdFunction)->RangeMultiplier(8)->Range(64, 32768);
@@ -0,0 +1,56 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for LoopsBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+#include "TotalCost.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/* TotalCost (range based loop) vs LambdaTotalCost (std::accumulate), see Loops.cpp */
+
+namespace {
+
+std::vector<CItem> makeItems(std::size_t size) {
+    std::vector<CItem> vecItems;
+    vecItems.reserve(size);
+    for ( std::size_t i = 0; i < size; ++i ) {
+        vecItems.push_back(CItem(static_cast<int>(i % 100)));
+    }
+    return vecItems;
+}
+
+} // namespace
+
+// both only bind the rvalue reference, so moving the same vector in again is fine
+static void TotalCostRangeBased(benchmark::State & state) {
+    std::vector<CItem> vecItems = makeItems(static_cast<std::size_t>(state.range(0)));
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(TotalCost(std::move(vecItems)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(TotalCostRangeBased)->RangeMultiplier(16)->Range(16, 1 << 20);
+
+static void TotalCostLambda(benchmark::State & state) {
+    std::vector<CItem> vecItems = makeItems(static_cast<std::size_t>(state.range(0)));
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(LambdaTotalCost(std::move(vecItems)));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(TotalCostLambda)->RangeMultiplier(16)->Range(16, 1 << 20);
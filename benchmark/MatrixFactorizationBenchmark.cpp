@@ -0,0 +1,102 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for MatrixFactorizationBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+#include "MatrixFactorization.h"
+
+#include <cstddef>
+#include <random>
+
+/* blocked factorizations (include/MatrixFactorization.h) vs the same code
+ * with one block, the textbook unblocked loop. The unblocked versions stop
+ * at 2048, at 8192 they run for many minutes. */
+
+// symmetric, diagonally dominant: positive definite and well conditioned
+static CMatrix testMatrix(std::size_t n) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+    CMatrix result(n, n);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        for ( std::size_t j = 0; j < i; ++j ) {
+            result(i, j) = result(j, i) = distribution(generator);
+        }
+        result(i, i) = static_cast<double>(n);
+    }
+    return result;
+}
+
+static void reportFlops(benchmark::State & state, double flops) {
+    state.counters["flops"] = benchmark::Counter(flops, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static void Multiply(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const CMatrix matrix = testMatrix(n);
+
+    for ( auto _ : state ) {
+        CMatrix product = multiply(matrix, matrix);
+        benchmark::DoNotOptimize(product.data());
+    }
+    reportFlops(state, 2.0 * n * n * n);
+}
+BENCHMARK(Multiply)->RangeMultiplier(2)->Range(256, 2048)->Unit(benchmark::kMillisecond);
+
+// the copy of the matrix for the constructor is part of the time, O(n^2) of O(n^3)
+template <typename Factorization>
+static void Factorize(benchmark::State & state, std::size_t blockSize, double flopsPerCube) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const CMatrix matrix = testMatrix(n);
+
+    for ( auto _ : state ) {
+        Factorization factorization(matrix, blockSize);
+        benchmark::DoNotOptimize(&factorization);
+    }
+    reportFlops(state, flopsPerCube * n * n * n);
+}
+
+static void LuBlocked(benchmark::State & state) {
+    Factorize<CLuFactorization>(state, CFactorization::DEFAULT_BLOCK_SIZE, 2.0 / 3.0);
+}
+BENCHMARK(LuBlocked)->RangeMultiplier(2)->Range(256, 8192)->Unit(benchmark::kMillisecond);
+
+static void LuUnblocked(benchmark::State & state) {
+    Factorize<CLuFactorization>(state, static_cast<std::size_t>(state.range(0)), 2.0 / 3.0);
+}
+BENCHMARK(LuUnblocked)->RangeMultiplier(2)->Range(256, 2048)->Unit(benchmark::kMillisecond);
+
+static void CholeskyBlocked(benchmark::State & state) {
+    Factorize<CCholeskyFactorization>(state, CFactorization::DEFAULT_BLOCK_SIZE, 1.0 / 3.0);
+}
+BENCHMARK(CholeskyBlocked)->RangeMultiplier(2)->Range(256, 8192)->Unit(benchmark::kMillisecond);
+
+static void CholeskyUnblocked(benchmark::State & state) {
+    Factorize<CCholeskyFactorization>(state, static_cast<std::size_t>(state.range(0)), 1.0 / 3.0);
+}
+BENCHMARK(CholeskyUnblocked)->RangeMultiplier(2)->Range(256, 2048)->Unit(benchmark::kMillisecond);
+
+// one factorization, many right hand sides: items = right hand sides
+static void LuSolve(benchmark::State & state) {
+    const std::size_t n = 1024;
+    const std::size_t columns = static_cast<std::size_t>(state.range(0));
+    const CMatrix matrix = testMatrix(n);
+    const CLuFactorization lu(matrix);
+    const CMatrix vectors(n, columns);
+
+    for ( auto _ : state ) {
+        CMatrix solutions = lu.solve(vectors);
+        benchmark::DoNotOptimize(solutions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(columns));
+}
+BENCHMARK(LuSolve)->RangeMultiplier(8)->Range(1, 512)->Unit(benchmark::kMicrosecond);
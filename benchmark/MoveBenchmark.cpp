@@ -0,0 +1,179 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for MoveBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+#include "FixedMatrix.h"
+#include "Matrix.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/* CMatrix copy vs move (see Move.cpp) */
+
+static void MatrixCopy(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    CMatrix matrix(n, n);
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        CMatrix copy(matrix);
+        benchmark::DoNotOptimize(&copy);
+    }
+    reportAllocations(state, trace);
+    state.SetBytesProcessed(state.iterations() * static_cast<long long>(n * n * sizeof(double)));
+}
+BENCHMARK(MatrixCopy)->RangeMultiplier(4)->Range(4, 1024);
+
+static void MatrixMove(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    CMatrix matrix(n, n);
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        CMatrix moved(std::move(matrix));
+        benchmark::DoNotOptimize(&moved);
+        matrix = std::move(moved);
+    }
+    reportAllocations(state, trace);
+}
+BENCHMARK(MatrixMove)->RangeMultiplier(4)->Range(4, 1024);
+
+// swapMatrices of Move.cpp
+static void MatrixSwapByCopy(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    CMatrix matrixA(n, n);
+    CMatrix matrixB(n, n);
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        CMatrix matrixTmp(matrixA);
+        matrixA = matrixB;
+        matrixB = matrixTmp;
+        benchmark::ClobberMemory();
+    }
+    reportAllocations(state, trace);
+}
+BENCHMARK(MatrixSwapByCopy)->RangeMultiplier(4)->Range(4, 1024);
+
+static void MatrixSwapByMove(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    CMatrix matrixA(n, n);
+    CMatrix matrixB(n, n);
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        std::swap(matrixA, matrixB);
+        benchmark::ClobberMemory();
+    }
+    reportAllocations(state, trace);
+}
+BENCHMARK(MatrixSwapByMove)->RangeMultiplier(4)->Range(4, 1024);
+
+/* CFixedMatrix<N,N>: one at a time (array of structures) vs the batch
+ * kernels (structure of arrays), items = matrices */
+
+template <std::size_t N>
+static CFixedMatrix<N,N> fixedMatrix(std::size_t seed) {
+    CFixedMatrix<N,N> result;
+    for ( std::size_t i = 0; i < result.size(); ++i ) {
+        result.data()[i] = 0.5 + static_cast<double>((seed + i) % 7);
+    }
+    return result;
+}
+
+template <std::size_t N>
+static void FixedMatrixMultiply(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    std::vector<CFixedMatrix<N,N>> vecA, vecB, vecC(n);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        vecA.push_back(fixedMatrix<N>(i));
+        vecB.push_back(fixedMatrix<N>(i + 3));
+    }
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        for ( std::size_t i = 0; i < n; ++i ) {
+            vecC[i] = vecA[i] * vecB[i];
+        }
+        benchmark::DoNotOptimize(vecC.data());
+        benchmark::ClobberMemory();
+    }
+    reportAllocations(state, trace);
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(n));
+}
+BENCHMARK_TEMPLATE(FixedMatrixMultiply, 3)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(FixedMatrixMultiply, 4)->RangeMultiplier(8)->Range(8, 4096);
+
+template <std::size_t N>
+static void FixedMatrixBatchMultiply(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    CFixedMatrixBatch<N,N> batchA, batchB, batchC(n);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        batchA.push_back(fixedMatrix<N>(i));
+        batchB.push_back(fixedMatrix<N>(i + 3));
+    }
+
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        multiply(batchA, batchB, batchC);
+        benchmark::DoNotOptimize(batchC.lane(0, 0));
+        benchmark::ClobberMemory();
+    }
+    reportAllocations(state, trace);
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(n));
+}
+BENCHMARK_TEMPLATE(FixedMatrixBatchMultiply, 3)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(FixedMatrixBatchMultiply, 4)->RangeMultiplier(8)->Range(8, 4096);
+
+// one transformation applied to many matrices
+template <std::size_t N>
+static void FixedMatrixTransform(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const CFixedMatrix<N,N> transform = fixedMatrix<N>(1);
+    std::vector<CFixedMatrix<N,N>> vecB, vecC(n);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        vecB.push_back(fixedMatrix<N>(i));
+    }
+
+    for ( auto _ : state ) {
+        for ( std::size_t i = 0; i < n; ++i ) {
+            vecC[i] = transform * vecB[i];
+        }
+        benchmark::DoNotOptimize(vecC.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(n));
+}
+BENCHMARK_TEMPLATE(FixedMatrixTransform, 3)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(FixedMatrixTransform, 4)->RangeMultiplier(8)->Range(8, 4096);
+
+template <std::size_t N>
+static void FixedMatrixBatchTransform(benchmark::State & state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const CFixedMatrix<N,N> transform = fixedMatrix<N>(1);
+    CFixedMatrixBatch<N,N> batchB, batchC(n);
+    for ( std::size_t i = 0; i < n; ++i ) {
+        batchB.push_back(fixedMatrix<N>(i));
+    }
+
+    for ( auto _ : state ) {
+        multiply(transform, batchB, batchC);
+        benchmark::DoNotOptimize(batchC.lane(0, 0));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<long long>(n));
+}
+BENCHMARK_TEMPLATE(FixedMatrixBatchTransform, 3)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(FixedMatrixBatchTransform, 4)->RangeMultiplier(8)->Range(8, 4096);
@@ -0,0 +1,56 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for ProfilerBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Benchmark.h"
+#include "Profiler.h"
+
+/* cost of an empty PROFILE_SCOPE and PROFILE_COUNT, on and off
+ * (target: below 20 ns per scope when on) */
+
+static void ProfileScopeOff(benchmark::State & state) {
+    CProfiler::instance().setEnabled(false);
+    for ( auto _ : state ) {
+        PROFILE_SCOPE("ProfileScopeOff");
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(ProfileScopeOff);
+
+static void ProfileScopeOn(benchmark::State & state) {
+    CProfiler::instance().setEnabled(true);
+    for ( auto _ : state ) {
+        PROFILE_SCOPE("ProfileScopeOn");
+        benchmark::ClobberMemory();
+    }
+    CProfiler::instance().setEnabled(false);
+}
+BENCHMARK(ProfileScopeOn)->ThreadRange(1, 8)->UseRealTime();
+
+static void ProfileCountOn(benchmark::State & state) {
+    CProfiler::instance().setEnabled(true);
+    for ( auto _ : state ) {
+        PROFILE_COUNT("ProfileCountOn", 1);
+        benchmark::ClobberMemory();
+    }
+    CProfiler::instance().setEnabled(false);
+}
+BENCHMARK(ProfileCountOn);
+
+// the clock alone, for comparison
+static void ProfileClockNow(benchmark::State & state) {
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(CProfileClock::now());
+    }
+}
+BENCHMARK(ProfileClockNow);
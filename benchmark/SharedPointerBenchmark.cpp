@@ -0,0 +1,165 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for SharedPointerBenchmark.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "AtomicSharedPtr.h"
+#include "Benchmark.h"
+#include "FancyWindow.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/* make_shared, copying shared pointers and publishing a CFancyWindow
+ * (see SharedPointer.cpp) */
+
+// one allocation for object and reference count
+static void SharedPointerMakeShared(benchmark::State & state) {
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        auto window = std::make_shared<CFancyWindow>(600, 400);
+        benchmark::DoNotOptimize(window.get());
+    }
+    reportAllocations(state, trace);
+}
+BENCHMARK(SharedPointerMakeShared);
+
+// two allocations
+static void SharedPointerNew(benchmark::State & state) {
+    CTraceScope trace;
+    for ( auto _ : state ) {
+        std::shared_ptr<CFancyWindow> window(new CFancyWindow(600, 400));
+        benchmark::DoNotOptimize(window.get());
+    }
+    reportAllocations(state, trace);
+}
+BENCHMARK(SharedPointerNew);
+
+namespace {
+
+// not inlined, so the copy of the parameter really happens
+__attribute__((noinline)) int widthByValue(std::shared_ptr<CFancyWindow> window) {
+    return window->width();
+}
+
+__attribute__((noinline)) int widthByReference(const std::shared_ptr<CFancyWindow> & window) {
+    return window->width();
+}
+
+} // namespace
+
+// atomic increment and decrement of the reference count per call
+static void SharedPointerPassByValue(benchmark::State & state) {
+    auto window = std::make_shared<CFancyWindow>(600, 400);
+    std::shared_ptr<CFancyWindow> other = window; // > 1 owner, as in real code
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(widthByValue(window));
+    }
+}
+BENCHMARK(SharedPointerPassByValue);
+
+static void SharedPointerPassByReference(benchmark::State & state) {
+    auto window = std::make_shared<CFancyWindow>(600, 400);
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(widthByReference(window));
+    }
+}
+BENCHMARK(SharedPointerPassByReference);
+
+
+/* reader scaling: CAtomicSharedPtr against a shared_ptr guarded by a mutex */
+
+namespace {
+
+struct CLockedWindow {
+    std::shared_ptr<const CFancyWindow> load() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pWindow;
+    }
+
+    void store(std::shared_ptr<const CFancyWindow> pWindow) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pWindow = std::move(pWindow);
+    }
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const CFancyWindow> m_pWindow = std::make_shared<const CFancyWindow>(600, 400);
+};
+
+/* publishes new windows as fast as it can while the benchmark threads
+ * read; started and stopped by benchmark thread 0 outside the timed loop */
+template <typename Window>
+class CBusyWriter {
+public:
+    CBusyWriter(benchmark::State & state, Window & window) : m_bActive(state.thread_index() == 0), m_bDone(false) {
+        if ( m_bActive ) {
+            m_thread = std::thread([this, &window] () {
+                for ( int i = 1; !m_bDone.load(std::memory_order_relaxed); ++i ) {
+                    window.store(std::make_shared<const CFancyWindow>(600 + i % 2, 400));
+                }
+            } );
+        }
+    }
+
+    ~CBusyWriter() {
+        if ( m_bActive ) {
+            m_bDone = true;
+            m_thread.join();
+        }
+    }
+
+private:
+    bool m_bActive;
+    std::atomic<bool> m_bDone;
+    std::thread m_thread;
+};
+
+CLockedWindow lockedWindow;
+CAtomicSharedPtr<const CFancyWindow> atomicWindow(std::make_shared<const CFancyWindow>(600, 400));
+
+} // namespace
+
+static void PublishedWindowMutex(benchmark::State & state) {
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(lockedWindow.load()->width());
+    }
+}
+BENCHMARK(PublishedWindowMutex)->ThreadRange(1, 8)->UseRealTime();
+
+static void PublishedWindowAtomicRead(benchmark::State & state) {
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(atomicWindow.read()->width());
+    }
+}
+BENCHMARK(PublishedWindowAtomicRead)->ThreadRange(1, 8)->UseRealTime();
+
+// the same with a concurrent store(): the contention the hazard pointers are for
+static void PublishedWindowMutexWithWriter(benchmark::State & state) {
+    CBusyWriter<CLockedWindow> writer(state, lockedWindow);
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(lockedWindow.load()->width());
+    }
+}
+BENCHMARK(PublishedWindowMutexWithWriter)->ThreadRange(1, 8)->UseRealTime();
+
+static void PublishedWindowAtomicReadWithWriter(benchmark::State & state) {
+    CBusyWriter<CAtomicSharedPtr<const CFancyWindow>> writer(state, atomicWindow);
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(atomicWindow.read()->width());
+    }
+}
+BENCHMARK(PublishedWindowAtomicReadWithWriter)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,65 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for PipelineFold.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "BuilderPipeline.h"
+
+/* Not part of the benchmark executable: compiled to assembly by
+ * "make asmcheck", check_asm.py then checks the ASMCHECK lines below
+ * against the code of the named function. The build fails if the builder
+ * pipeline (include/BuilderPipeline.h) stops folding away.
+ */
+
+namespace {
+
+struct CConstantBuilder {
+    constexpr int makeObject() const {
+        return 6;
+    }
+};
+
+struct CValueBuilder {
+    int makeObject() const {
+        return m_iValue;
+    }
+
+    int m_iValue;
+};
+
+struct AddOne {
+    constexpr int operator() (int value) const {
+        return value + 1;
+    }
+};
+
+struct Square {
+    constexpr long operator() (int value) const {
+        return static_cast<long>(value) * value;
+    }
+};
+
+} // namespace
+
+// ASMCHECK pipelineConstant: contains \$49\b
+// ASMCHECK pipelineConstant: lacks \bcall
+// ASMCHECK pipelineConstant: lacks \bimul
+extern "C" long pipelineConstant() {
+    return (CConstantBuilder() | AddOne() | Square()).makeObject();
+}
+
+// the same instructions as the hand written (value + 1) * (value + 1)
+// ASMCHECK pipelineRuntime: lacks \bcall
+// ASMCHECK pipelineRuntime: contains \bimul
+extern "C" long pipelineRuntime(int value) {
+    return (CValueBuilder{ value } | AddOne() | Square()).makeObject();
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Checks the generated assembly of a source file against the expectations
+written into the source itself:
+
+    // ASMCHECK <function>: contains <regex>
+    // ASMCHECK <function>: lacks <regex>
+
+The function must have C linkage (extern "C"), so its label is its name.
+Exits with 1 if an expectation fails or a function is not found.
+
+    check_asm.py asmcheck/PipelineFold.cpp obj/PipelineFold.s
+"""
+
+import argparse
+import re
+import sys
+
+CHECK = re.compile(r'//\s*ASMCHECK\s+(\w+):\s+(contains|lacks)\s+(.+?)\s*$')
+
+
+def function_body(assembly, name):
+    """instructions from the label of name to the end of the function"""
+    lines = assembly.splitlines()
+    for start, line in enumerate(lines):
+        if line.strip() == name + ':':
+            break
+    else:
+        return None
+    body = []
+    for line in lines[start + 1:]:
+        stripped = line.strip()
+        if stripped.startswith('.cfi_endproc') or stripped.startswith('.size'):
+            break
+        if stripped and not stripped.startswith('.'):
+            body.append(stripped)
+    return body
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('source')
+    parser.add_argument('assembly')
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        checks = [m.groups() for m in map(CHECK.search, f) if m]
+    with open(args.assembly) as f:
+        assembly = f.read()
+
+    if not checks:
+        print('%s: no ASMCHECK lines' % args.source)
+        return 1
+
+    failures = 0
+    for name, kind, pattern in checks:
+        body = function_body(assembly, name)
+        if body is None:
+            print('FAIL %s: function not found in %s' % (name, args.assembly))
+            failures += 1
+            continue
+        found = any(re.search(pattern, line) for line in body)
+        if found != (kind == 'contains'):
+            print('FAIL %s: %s %s' % (name, kind, pattern))
+            for line in body:
+                print('    ' + line)
+            failures += 1
+        else:
+            print('ok   %s: %s %s' % (name, kind, pattern))
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Compares two JSON outputs of cpp11-benchmarks (--benchmark_out_format=json).
+
+A benchmark regresses if its time grows by more than the threshold, or if
+its allocations per iteration ("allocs/iter") grow at all. With
+--benchmark_repetitions the median of the repetitions is compared.
+
+    compare.py [--threshold 0.10] [--metric real_time] baseline.json contender.json
+
+Exits with 1 if there is at least one regression.
+"""
+
+import argparse
+import json
+import sys
+
+TIME_UNITS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+ALLOCATIONS = 'allocs/iter'
+
+
+def load(path, metric):
+    """name -> (time in ns, allocations per iteration or None)"""
+    with open(path) as f:
+        benchmarks = json.load(f)['benchmarks']
+
+    # prefer the median aggregate of repeated runs
+    medians = {b['run_name']: b for b in benchmarks
+               if b.get('run_type') == 'aggregate' and b.get('aggregate_name') == 'median'}
+    results = {}
+    for b in benchmarks:
+        if b.get('run_type') == 'aggregate' or 'error_occurred' in b:
+            continue
+        name = b.get('run_name', b['name'])
+        if name in results:
+            continue
+        b = medians.get(name, b)
+        results[name] = (b[metric] * TIME_UNITS[b.get('time_unit', 'ns')], b.get(ALLOCATIONS))
+    return results
+
+
+def format_time(ns):
+    for unit in ('s', 'ms', 'us'):
+        if ns >= TIME_UNITS[unit]:
+            return '%.3g %s' % (ns / TIME_UNITS[unit], unit)
+    return '%.3g ns' % ns
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--threshold', type=float, default=0.10,
+                        help='relative slow down that counts as regression (default 0.10)')
+    parser.add_argument('--metric', default='real_time', choices=('real_time', 'cpu_time'))
+    parser.add_argument('baseline')
+    parser.add_argument('contender')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    contender = load(args.contender, args.metric)
+
+    regressions = 0
+    width = max([len(name) for name in list(baseline) + list(contender)] + [9])
+    print('%-*s %12s %12s %9s' % (width, 'Benchmark', 'Baseline', 'Contender', 'Change'))
+    for name, (time, allocations) in contender.items():
+        if name not in baseline:
+            print('%-*s %12s %12s %9s' % (width, name, '-', format_time(time), 'new'))
+            continue
+        baseTime, baseAllocations = baseline[name]
+        change = (time - baseTime) / baseTime if baseTime else 0.0
+        notes = []
+        if change > args.threshold:
+            notes.append('REGRESSION')
+        elif change < -args.threshold:
+            notes.append('faster')
+        if allocations is not None and baseAllocations is not None and allocations > baseAllocations:
+            notes.append('REGRESSION allocs/iter %.3g -> %.3g' % (baseAllocations, allocations))
+        if any(note.startswith('REGRESSION') for note in notes):
+            regressions += 1
+        print('%-*s %12s %12s %+8.1f%% %s' % (width, name, format_time(baseTime), format_time(time),
+                                             100.0 * change, ' '.join(notes)))
+    for name in baseline:
+        if name not in contender:
+            print('%-*s %12s %12s %9s' % (width, name, format_time(baseline[name][0]), '-', 'gone'))
+
+    print('%d regression(s), threshold %.0f%%' % (regressions, 100.0 * args.threshold))
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,78 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for AddressBook.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef ADDRESSBOOK_H_
+#define ADDRESSBOOK_H_
+
+#include "Profiler.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/* the address books of Lambda.cpp */
+
+class CAddressBook {
+public:
+    // using a template allows us to ignore the differences between functors, function pointers
+    // and lambda
+    template<typename Func>
+    std::vector<std::string> findMatchingAddresses (Func func) const {
+        PROFILE_SCOPE("CAddressBook::findMatchingAddresses");
+        std::vector<std::string> vec_results;
+        for ( auto itr = m_strAddresses.begin(), end = m_strAddresses.end(); itr != end; ++itr ) {
+            // call the function passed into findMatchingAddresses and see if it matches
+            if ( func( *itr ) ) {
+                vec_results.push_back( *itr );
+            }
+        }
+        return vec_results;
+    }
+
+    void addAddress(std::string strAddress) {
+        m_strAddresses.emplace_back(strAddress);
+    }
+
+private:
+    std::vector<std::string> m_strAddresses;
+};
+
+/* Addressbook without template */
+class CAnotherAddressBook
+{
+    public:
+    std::vector<std::string> findMatchingAddresses (std::function<bool (const std::string&)> func)
+    {
+        PROFILE_SCOPE("CAnotherAddressBook::findMatchingAddresses");
+        std::vector<std::string> results;
+        for ( auto itr = m_strAddresses.begin(), end = m_strAddresses.end(); itr != end; ++itr )
+        {
+            // call the function passed into findMatchingAddresses and see if it matches
+            if ( func( *itr ) )
+            {
+                results.push_back( *itr );
+            }
+        }
+        return results;
+    }
+
+    void addAddress(std::string strAddress) {
+        m_strAddresses.emplace_back(strAddress);
+    }
+
+    private:
+    std::vector<std::string> m_strAddresses;
+};
+
+#endif /* ADDRESSBOOK_H_ */
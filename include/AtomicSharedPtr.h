@@ -0,0 +1,299 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for AtomicSharedPtr.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef ATOMICSHAREDPTR_H_
+#define ATOMICSHAREDPTR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/* Hazard pointers: every thread owns a few slots on its own cache line.
+ * A reader announces the pointer it is about to dereference in one of its
+ * slots; a writer only frees retired objects which are announced nowhere.
+ * Readers thus never write to a shared cache line.
+ *
+ * A slot is claimed by the thread owning the record, but may be released
+ * from any thread (a read handle can be moved to another thread). A record
+ * whose thread exits while some of its slots are still claimed stays in
+ * use until the last of them is released.
+ */
+class CHazardDomain {
+public:
+    static const std::size_t SLOTS_PER_THREAD = 4;
+    static const std::size_t MAX_THREADS = 128;
+
+    typedef std::atomic<const void *> Slot;
+
+    struct CThreadRecord;
+
+    static CHazardDomain & instance() {
+        static CHazardDomain domain;
+        return domain;
+    }
+
+    /* returns nullptr if the calling thread has no free slot left (or there
+     * are already MAX_THREADS threads with a record), otherwise a slot of
+     * the record returned in pRecord */
+    Slot * acquireSlot(CThreadRecord *& pRecord) {
+        CThreadRecordOwner & owner = threadRecordOwner();
+        if ( !owner.m_pRecord ) {
+            owner.m_pRecord = claimRecord();
+            if ( !owner.m_pRecord ) {
+                return nullptr;
+            }
+        }
+        // only this thread sets bits, others may clear them meanwhile
+        const unsigned int uiUsed = owner.m_pRecord->m_uiUsedSlots.load(std::memory_order_acquire);
+        for ( std::size_t i = 0; i < SLOTS_PER_THREAD; ++i ) {
+            if ( !(uiUsed & (1u << i)) ) {
+                owner.m_pRecord->m_uiUsedSlots.fetch_or(1u << i, std::memory_order_acq_rel);
+                pRecord = owner.m_pRecord;
+                return &owner.m_pRecord->m_pSlots[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // any thread; pRecord as returned by acquireSlot()
+    void releaseSlot(CThreadRecord * pRecord, Slot * pSlot) {
+        pSlot->store(nullptr, std::memory_order_release);
+        const unsigned int uiBit = 1u << (pSlot - pRecord->m_pSlots);
+        if ( pRecord->m_uiUsedSlots.fetch_and(~uiBit, std::memory_order_acq_rel) == (uiBit | ORPHANED) ) {
+            releaseRecord(pRecord);
+        }
+    }
+
+    // sorted list of all currently announced pointers
+    std::vector<const void *> protectedPointers() const {
+        std::vector<const void *> vecResult;
+        for ( std::size_t i = 0; i < MAX_THREADS; ++i ) {
+            if ( !m_records[i].m_bInUse.load(std::memory_order_acquire) ) {
+                continue;
+            }
+            for ( std::size_t j = 0; j < SLOTS_PER_THREAD; ++j ) {
+                const void * p = m_records[i].m_pSlots[j].load(std::memory_order_seq_cst);
+                if ( p ) {
+                    vecResult.push_back(p);
+                }
+            }
+        }
+        std::sort(vecResult.begin(), vecResult.end());
+        return vecResult;
+    }
+
+    struct alignas(64) CThreadRecord {
+        std::atomic<bool> m_bInUse;
+        // bit i: slot i claimed; ORPHANED: the owning thread has exited
+        std::atomic<unsigned int> m_uiUsedSlots;
+        Slot m_pSlots[SLOTS_PER_THREAD];
+    };
+
+private:
+    static const unsigned int ORPHANED = 1u << 31;
+
+    // gives the record back when the owning thread exits
+    struct CThreadRecordOwner {
+        CThreadRecord * m_pRecord;
+
+        ~CThreadRecordOwner() {
+            if ( m_pRecord && m_pRecord->m_uiUsedSlots.fetch_or(ORPHANED, std::memory_order_acq_rel) == 0 ) {
+                instance().releaseRecord(m_pRecord);
+            }
+        }
+    };
+
+    CHazardDomain() {
+        for ( std::size_t i = 0; i < MAX_THREADS; ++i ) {
+            m_records[i].m_bInUse.store(false);
+            m_records[i].m_uiUsedSlots.store(0);
+            for ( std::size_t j = 0; j < SLOTS_PER_THREAD; ++j ) {
+                m_records[i].m_pSlots[j].store(nullptr);
+            }
+        }
+    }
+
+    CHazardDomain(const CHazardDomain &) = delete;
+    CHazardDomain & operator=(const CHazardDomain &) = delete;
+
+    static CThreadRecordOwner & threadRecordOwner() {
+        static thread_local CThreadRecordOwner owner{nullptr};
+        return owner;
+    }
+
+    CThreadRecord * claimRecord() {
+        for ( std::size_t i = 0; i < MAX_THREADS; ++i ) {
+            bool bExpected = false;
+            if ( m_records[i].m_bInUse.compare_exchange_strong(bExpected, true, std::memory_order_acq_rel) ) {
+                return &m_records[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // no slot claimed anymore and no owning thread
+    void releaseRecord(CThreadRecord * pRecord) {
+        pRecord->m_uiUsedSlots.store(0, std::memory_order_relaxed);
+        pRecord->m_bInUse.store(false, std::memory_order_release);
+    }
+
+    CThreadRecord m_records[MAX_THREADS];
+};
+
+
+/* A cell holding a std::shared_ptr which many threads read while one updater
+ * publishes new values.
+ *  - read() hands out a hazard protected handle: no lock, no reference count
+ *    increment, only a store to the thread's own hazard slot
+ *  - load() hands out a real std::shared_ptr (one reference count increment)
+ *  - store() publishes a new value and frees old ones no reader still sees
+ * Updaters are serialised by a mutex, readers never touch it, except for a
+ * silent fallback: a thread holding more than SLOTS_PER_THREAD handles at
+ * once, or any thread beyond the first MAX_THREADS with a record, gets a
+ * handle owning a std::shared_ptr copied under the mutex. Such reads are
+ * correct but as slow as CLockedWindow in the benchmark.
+ */
+template <typename T>
+class CAtomicSharedPtr {
+public:
+    typedef std::shared_ptr<T> Pointer;
+
+    class CReadHandle {
+    public:
+        // the slot stays claimed, the handle may be destroyed on another thread
+        CReadHandle(CReadHandle && other) :
+            m_pRecord(other.m_pRecord),
+            m_pSlot(other.m_pSlot),
+            m_pValue(other.m_pValue),
+            m_pFallback(std::move(other.m_pFallback)) {
+            other.m_pSlot = nullptr;
+            other.m_pValue = nullptr;
+        }
+
+        ~CReadHandle() {
+            if ( m_pSlot ) {
+                CHazardDomain::instance().releaseSlot(m_pRecord, m_pSlot);
+            }
+        }
+
+        T * get() const { return m_pValue; }
+        T & operator* () const { return *m_pValue; }
+        T * operator-> () const { return m_pValue; }
+        explicit operator bool () const { return m_pValue != nullptr; }
+
+    private:
+        friend class CAtomicSharedPtr;
+
+        CReadHandle(CHazardDomain::CThreadRecord * pRecord, CHazardDomain::Slot * pSlot, T * pValue) :
+            m_pRecord(pRecord), m_pSlot(pSlot), m_pValue(pValue) {}
+
+        explicit CReadHandle(Pointer pFallback) :
+            m_pRecord(nullptr), m_pSlot(nullptr), m_pValue(pFallback.get()), m_pFallback(std::move(pFallback)) {}
+
+        CReadHandle(const CReadHandle &) = delete;
+        CReadHandle & operator=(const CReadHandle &) = delete;
+
+        CHazardDomain::CThreadRecord * m_pRecord;
+        CHazardDomain::Slot * m_pSlot;
+        T * m_pValue;
+        Pointer m_pFallback;
+    };
+
+    CAtomicSharedPtr() : m_pCurrent(new Pointer()) {}
+
+    explicit CAtomicSharedPtr(Pointer pValue) : m_pCurrent(new Pointer(std::move(pValue))) {}
+
+    // no reader may be active anymore
+    ~CAtomicSharedPtr() {
+        delete m_pCurrent.load(std::memory_order_relaxed);
+        for ( auto itr = m_vecRetired.begin(), end = m_vecRetired.end(); itr != end; ++itr ) {
+            delete *itr;
+        }
+    }
+
+    CAtomicSharedPtr(const CAtomicSharedPtr &) = delete;
+    CAtomicSharedPtr & operator=(const CAtomicSharedPtr &) = delete;
+
+    CReadHandle read() const {
+        CHazardDomain::CThreadRecord * pRecord = nullptr;
+        CHazardDomain::Slot * pSlot = CHazardDomain::instance().acquireSlot(pRecord);
+        if ( !pSlot ) {
+            return CReadHandle(lockedLoad());
+        }
+        return CReadHandle(pRecord, pSlot, protect(pSlot)->get());
+    }
+
+    Pointer load() const {
+        CReadHandle handle(read());
+        if ( handle.m_pSlot ) {
+            return *static_cast<const Pointer *>(handle.m_pSlot->load(std::memory_order_relaxed));
+        }
+        return std::move(handle.m_pFallback);
+    }
+
+    void store(Pointer pValue) {
+        Pointer * pNew = new Pointer(std::move(pValue));
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        m_vecRetired.push_back(m_pCurrent.exchange(pNew, std::memory_order_seq_cst));
+        reclaim();
+    }
+
+    // number of old values still waiting for their readers
+    std::size_t retiredCount() const {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        return m_vecRetired.size();
+    }
+
+private:
+    // announce the current value and make sure it was not replaced meanwhile
+    Pointer * protect(CHazardDomain::Slot * pSlot) const {
+        Pointer * p = m_pCurrent.load(std::memory_order_acquire);
+        for (;;) {
+            pSlot->store(p, std::memory_order_seq_cst);
+            Pointer * pCheck = m_pCurrent.load(std::memory_order_seq_cst);
+            if ( pCheck == p ) {
+                return p;
+            }
+            p = pCheck;
+        }
+    }
+
+    Pointer lockedLoad() const {
+        std::lock_guard<std::mutex> lock(m_writerMutex);
+        return *m_pCurrent.load(std::memory_order_acquire);
+    }
+
+    // called with m_writerMutex held
+    void reclaim() {
+        std::vector<const void *> vecProtected = CHazardDomain::instance().protectedPointers();
+        auto itrKeep = std::partition(m_vecRetired.begin(), m_vecRetired.end(),
+                [&vecProtected] (Pointer * p) {
+            return std::binary_search(vecProtected.begin(), vecProtected.end(), static_cast<const void *>(p));
+        } );
+        for ( auto itr = itrKeep, end = m_vecRetired.end(); itr != end; ++itr ) {
+            delete *itr;
+        }
+        m_vecRetired.erase(itrKeep, m_vecRetired.end());
+    }
+
+    std::atomic<Pointer *> m_pCurrent;
+    mutable std::mutex m_writerMutex;
+    std::vector<Pointer *> m_vecRetired;
+};
+
+#endif /* ATOMICSHAREDPTR_H_ */
@@ -0,0 +1,189 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for BlockThreads.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef BLOCKTHREADS_H_
+#define BLOCKTHREADS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Worker threads for parallelBlocks(), started on first use and kept for
+ * the lifetime of the program. The factorizations (MatrixFactorization.h)
+ * call parallelBlocks() for every panel and tile, CPersonTable for every
+ * scan: starting a fresh team of threads each time would cost more than
+ * the small updates near the end of a matrix or a scan of a small table.
+ *
+ * The calling thread works along. Blocks are handed out one at a time to
+ * whichever thread is free. One run at a time: a call while the workers
+ * are busy, from another thread or from inside func, runs serially.
+ * If func throws, on any thread, no further blocks are started and run()
+ * rethrows the first exception once all threads are done.
+ */
+class CBlockThreads {
+public:
+    static CBlockThreads & instance() {
+        static CBlockThreads threads(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return threads;
+    }
+
+    ~CBlockThreads() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+        }
+        m_wakeUp.notify_all();
+        for ( auto& thread : m_vecThreads ) {
+            thread.join();
+        }
+    }
+
+    CBlockThreads(const CBlockThreads &) = delete;
+    CBlockThreads & operator=(const CBlockThreads &) = delete;
+
+    // threads working on a run, the calling one included
+    std::size_t size() const {
+        return m_vecThreads.size() + 1;
+    }
+
+    // calls func(block) for every block in [0, blocks)
+    template <typename Func>
+    void run(std::size_t blocks, Func & func) {
+        bool bIdle = false;
+        if ( m_vecThreads.empty() || blocks <= 1 || !m_bBusy.compare_exchange_strong(bIdle, true) ) {
+            for ( std::size_t block = 0; block < blocks; ++block ) {
+                func(block);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pFunc = &func;
+            m_pInvoke = &invoke<Func>;
+            m_blocks = blocks;
+            m_nextBlock.store(0, std::memory_order_relaxed);
+            m_working = m_vecThreads.size();
+            ++m_generation;
+        }
+        m_wakeUp.notify_all();
+        std::exception_ptr pException;
+        {
+            CRunGuard guard(*this, pException);
+            work();
+        }
+        if ( pException ) {
+            std::rethrow_exception(pException);
+        }
+    }
+
+private:
+    explicit CBlockThreads(std::size_t workers) :
+        m_bBusy(false), m_bStop(false), m_generation(0), m_working(0),
+        m_pFunc(nullptr), m_pInvoke(nullptr), m_blocks(0), m_nextBlock(0) {
+        for ( std::size_t i = 0; i < workers; ++i ) {
+            m_vecThreads.emplace_back([this] () { workerLoop(); });
+        }
+    }
+
+    // waits for the workers and frees them for the next run, whatever happens in between
+    class CRunGuard {
+    public:
+        CRunGuard(CBlockThreads & threads, std::exception_ptr & pException) :
+            m_threads(threads), m_pException(pException) {}
+
+        ~CRunGuard() {
+            {
+                std::unique_lock<std::mutex> lock(m_threads.m_mutex);
+                m_threads.m_done.wait(lock, [this] () { return m_threads.m_working == 0; });
+                m_pException = std::move(m_threads.m_pException);
+                m_threads.m_pException = nullptr;
+            }
+            m_threads.m_bBusy.store(false);
+        }
+
+        CRunGuard(const CRunGuard &) = delete;
+        CRunGuard & operator=(const CRunGuard &) = delete;
+
+    private:
+        CBlockThreads & m_threads;
+        std::exception_ptr & m_pException;
+    };
+
+    template <typename Func>
+    static void invoke(void * pFunc, std::size_t block) {
+        (*static_cast<Func *>(pFunc))(block);
+    }
+
+    void workerLoop() {
+        std::size_t generation = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [this, generation] () { return m_bStop || m_generation != generation; });
+                if ( m_bStop ) {
+                    return;
+                }
+                generation = m_generation;
+            }
+            work();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if ( --m_working == 0 ) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    void work() {
+        try {
+            for ( std::size_t block = m_nextBlock.fetch_add(1); block < m_blocks; block = m_nextBlock.fetch_add(1) ) {
+                m_pInvoke(m_pFunc, block);
+            }
+        }
+        catch ( ... ) {
+            m_nextBlock.store(m_blocks);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if ( !m_pException ) {
+                m_pException = std::current_exception();
+            }
+        }
+    }
+
+    std::atomic<bool> m_bBusy;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    bool m_bStop;
+    std::size_t m_generation;
+    std::size_t m_working;  // workers not done with the current run
+    // the current run, set under m_mutex before the workers are woken
+    void * m_pFunc;
+    void (*m_pInvoke)(void *, std::size_t);
+    std::size_t m_blocks;
+    std::atomic<std::size_t> m_nextBlock;
+    std::exception_ptr m_pException;  // the first one thrown by func
+    std::vector<std::thread> m_vecThreads;
+};
+
+// calls func(block) for every block in [0, blocks), in parallel on CBlockThreads
+template <typename Func>
+void parallelBlocks(std::size_t blocks, Func func) {
+    CBlockThreads::instance().run(blocks, func);
+}
+
+#endif /* BLOCKTHREADS_H_ */
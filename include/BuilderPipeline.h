@@ -0,0 +1,55 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for BuilderPipeline.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef BUILDERPIPELINE_H_
+#define BUILDERPIPELINE_H_
+
+#include <utility>
+
+/* builder | stage | stage ...
+ *
+ * A pipeline is a builder itself: makeObject() calls the builder and feeds
+ * the result through all stages. Every type is deduced with decltype at
+ * compile time, there is no intermediate object besides the temporaries
+ * handed from stage to stage (which the compiler inlines away), and the
+ * final result is returned as prvalue, i.e. constructed in the caller's
+ * storage (RVO). If builder and stages are constexpr, the whole chain can be
+ * evaluated at compile time.
+ */
+template <typename Builder, typename Stage>
+class CPipeline {
+public:
+    constexpr CPipeline(Builder builder, Stage stage) :
+        m_builder(builder), m_stage(stage) {}
+
+    constexpr auto makeObject() const -> decltype( std::declval<const Stage&>()( std::declval<const Builder&>().makeObject() ) )
+    {
+        return m_stage( m_builder.makeObject() );
+    }
+
+private:
+    Builder m_builder;
+    Stage m_stage;
+};
+
+/* only takes part in overload resolution if builder and stage fit together,
+ * thus enums and other types keep their own operator| */
+template <typename Builder, typename Stage,
+          typename = decltype( std::declval<const Stage&>()( std::declval<const Builder&>().makeObject() ) )>
+constexpr CPipeline<Builder, Stage> operator| (Builder builder, Stage stage)
+{
+    return CPipeline<Builder, Stage>(builder, stage);
+}
+
+#endif /* BUILDERPIPELINE_H_ */
@@ -0,0 +1,38 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for FancyWindow.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef FANCYWINDOW_H_
+#define FANCYWINDOW_H_
+
+/* a custom demo class
+ */
+class CFancyWindow {
+public:
+    CFancyWindow(int iWidth, int iHeight) : m_iWidth(iWidth), m_iHeight(iHeight) {
+        // some construction stuff
+    }
+
+    void maximize() {
+        // some code to maximize the window
+    }
+
+    int width() const { return m_iWidth; }
+    int height() const { return m_iHeight; }
+
+private:
+    int m_iWidth;
+    int m_iHeight;
+};
+
+#endif /* FANCYWINDOW_H_ */
@@ -0,0 +1,481 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for FixedMatrix.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef FIXEDMATRIX_H_
+#define FIXEDMATRIX_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Small matrices with their shape in the type (the dynamic CMatrix of
+ * include/Matrix.h stays for large shapes):
+ *  - the elements live inside the object, row major; no allocation
+ *  - rows() and columns() are constexpr, shapes are checked at compile time
+ *  - multiply, transpose and inverse are unrolled by CUnroll, multiply and
+ *    the row operations of inverse work on two columns at once with SSE2
+ */
+
+/* f(0), f(1), ..., f(N - 1), written out by the compiler */
+template <std::size_t N>
+struct CUnroll {
+    template <typename Func>
+    static void apply(Func func) {
+        CUnroll<N - 1>::apply(func);
+        func(N - 1);
+    }
+};
+
+template <>
+struct CUnroll<0> {
+    template <typename Func>
+    static void apply(Func) {}
+};
+
+
+template <std::size_t R, std::size_t C>
+class CFixedMatrix {
+    static_assert(R > 0 && C > 0, "CFixedMatrix: empty shape");
+
+public:
+    static constexpr std::size_t rows() { return R; }
+    static constexpr std::size_t columns() { return C; }
+    static constexpr std::size_t size() { return R * C; }
+
+    // all elements 0
+    CFixedMatrix() : m_elements() {}
+
+    // row major, missing elements are 0
+    CFixedMatrix(std::initializer_list<double> elements) : m_elements() {
+        if ( elements.size() > R * C ) {
+            throw std::invalid_argument("CFixedMatrix: too many elements");
+        }
+        std::size_t i = 0;
+        for ( double element : elements ) {
+            m_elements[i++] = element;
+        }
+    }
+
+    static CFixedMatrix identity() {
+        static_assert(R == C, "CFixedMatrix::identity: not square");
+        CFixedMatrix result;
+        CUnroll<R>::apply([&result] (std::size_t i) { result(i, i) = 1.0; });
+        return result;
+    }
+
+    double & operator() (std::size_t row, std::size_t column) {
+        return m_elements[row * C + column];
+    }
+
+    double operator() (std::size_t row, std::size_t column) const {
+        return m_elements[row * C + column];
+    }
+
+    double * data() { return m_elements; }
+    const double * data() const { return m_elements; }
+
+    CFixedMatrix<C, R> transpose() const {
+        CFixedMatrix<C, R> result;
+        const CFixedMatrix & self = *this;
+        CUnroll<R>::apply([&result, &self] (std::size_t i) {
+            CUnroll<C>::apply([&result, &self, i] (std::size_t j) {
+                result(j, i) = self(i, j);
+            } );
+        } );
+        return result;
+    }
+
+    /* Gauss-Jordan elimination with scaled partial pivoting, unrolled like
+     * operator*, the row operations two columns at a time with SSE2.
+     * Throws std::domain_error if the matrix is singular: a pivot below the
+     * rounding error of its row, R * epsilon * the largest element of that
+     * row in the matrix, counts as 0. Each row has its own scale, so
+     * diag(1e10, 1e-10) is fine, but rounding rarely leaves an exact 0 for
+     * a singular matrix. */
+    CFixedMatrix inverse() const {
+        static_assert(R == C, "CFixedMatrix::inverse: not square");
+        CFixedMatrix work(*this);
+        CFixedMatrix result = identity();
+        double tolerances[R];
+        CUnroll<R>::apply([&work, &tolerances] (std::size_t row) {
+            double largest = 0.0;
+            CUnroll<C>::apply([&work, &largest, row] (std::size_t column) {
+                largest = std::max(largest, std::abs(work(row, column)));
+            } );
+            tolerances[row] = R * std::numeric_limits<double>::epsilon() * largest;
+        } );
+        CUnroll<C>::apply([&work, &result, &tolerances] (std::size_t column) {
+            // the largest pivot relative to its row
+            std::size_t pivot = column;
+            for ( std::size_t row = column + 1; row < R; ++row ) {
+                if ( std::abs(work(row, column)) * tolerances[pivot] > std::abs(work(pivot, column)) * tolerances[row] ) {
+                    pivot = row;
+                }
+            }
+            if ( std::abs(work(pivot, column)) <= tolerances[pivot] ) {
+                throw std::domain_error("CFixedMatrix::inverse: singular matrix");
+            }
+            if ( pivot != column ) {
+                work.swapRows(pivot, column);
+                result.swapRows(pivot, column);
+                std::swap(tolerances[pivot], tolerances[column]);
+            }
+            const double scale = 1.0 / work(column, column);
+            work.scaleRow(column, scale);
+            result.scaleRow(column, scale);
+            CUnroll<R>::apply([&work, &result, column] (std::size_t row) {
+                if ( row != column && work(row, column) != 0.0 ) {
+                    const double factor = work(row, column);
+                    work.subtractRow(row, column, factor);
+                    result.subtractRow(row, column, factor);
+                }
+            } );
+        } );
+        return result;
+    }
+
+    bool operator== (const CFixedMatrix & other) const {
+        for ( std::size_t i = 0; i < R * C; ++i ) {
+            if ( m_elements[i] != other.m_elements[i] ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!= (const CFixedMatrix & other) const {
+        return !(*this == other);
+    }
+
+private:
+    void swapRows(std::size_t first, std::size_t second) {
+        CUnroll<C>::apply([this, first, second] (std::size_t j) {
+            std::swap((*this)(first, j), (*this)(second, j));
+        } );
+    }
+
+    void scaleRow(std::size_t row, double scale) {
+        double * pRow = m_elements + row * C;
+#ifdef __SSE2__
+        const __m128d scales = _mm_set1_pd(scale);
+        CUnroll<C / 2>::apply([pRow, scales] (std::size_t pair) {
+            _mm_storeu_pd(pRow + 2 * pair, _mm_mul_pd(_mm_loadu_pd(pRow + 2 * pair), scales));
+        } );
+        if ( C % 2 ) {
+            pRow[C - 1] *= scale;
+        }
+#else
+        CUnroll<C>::apply([pRow, scale] (std::size_t j) { pRow[j] *= scale; });
+#endif
+    }
+
+    // row -= factor * source
+    void subtractRow(std::size_t row, std::size_t source, double factor) {
+        double * pRow = m_elements + row * C;
+        const double * pSource = m_elements + source * C;
+#ifdef __SSE2__
+        const __m128d factors = _mm_set1_pd(factor);
+        CUnroll<C / 2>::apply([pRow, pSource, factors] (std::size_t pair) {
+            const __m128d products = _mm_mul_pd(factors, _mm_loadu_pd(pSource + 2 * pair));
+            _mm_storeu_pd(pRow + 2 * pair, _mm_sub_pd(_mm_loadu_pd(pRow + 2 * pair), products));
+        } );
+        if ( C % 2 ) {
+            pRow[C - 1] -= factor * pSource[C - 1];
+        }
+#else
+        CUnroll<C>::apply([pRow, pSource, factor] (std::size_t j) { pRow[j] -= factor * pSource[j]; });
+#endif
+    }
+
+    alignas(16) double m_elements[R * C];
+};
+
+/* row i of the result is the sum of a(i, k) * row k of b; with SSE2 two
+ * columns at a time, an odd last column on its own */
+template <std::size_t R, std::size_t K, std::size_t C>
+CFixedMatrix<R, C> operator* (const CFixedMatrix<R, K> & a, const CFixedMatrix<K, C> & b) {
+    CFixedMatrix<R, C> result;
+    CUnroll<R>::apply([&] (std::size_t i) {
+#ifdef __SSE2__
+        CUnroll<C / 2>::apply([&] (std::size_t pair) {
+            __m128d sum = _mm_setzero_pd();
+            CUnroll<K>::apply([&] (std::size_t k) {
+                sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(a(i, k)), _mm_loadu_pd(b.data() + k * C + 2 * pair)));
+            } );
+            _mm_storeu_pd(&result(i, 2 * pair), sum);
+        } );
+        const std::size_t first = C - C % 2;
+#else
+        const std::size_t first = 0;
+#endif
+        for ( std::size_t j = first; j < C; ++j ) {
+            double sum = 0.0;
+            CUnroll<K>::apply([&] (std::size_t k) { sum += a(i, k) * b(k, j); });
+            result(i, j) = sum;
+        }
+    } );
+    return result;
+}
+
+
+/* SIZE consecutive values of a batch lane, kept in registers */
+struct CLaneBlock {
+    enum { SIZE = 8 };
+
+#ifdef __SSE2__
+    // written out, a loop over the four registers would keep them in memory
+    CLaneBlock() :
+        m_values0(_mm_setzero_pd()), m_values1(_mm_setzero_pd()),
+        m_values2(_mm_setzero_pd()), m_values3(_mm_setzero_pd()) {}
+
+    // += a[n] * b[n]
+    void addProducts(const double * a, const double * b) {
+        m_values0 = _mm_add_pd(m_values0, _mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)));
+        m_values1 = _mm_add_pd(m_values1, _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+        m_values2 = _mm_add_pd(m_values2, _mm_mul_pd(_mm_loadu_pd(a + 4), _mm_loadu_pd(b + 4)));
+        m_values3 = _mm_add_pd(m_values3, _mm_mul_pd(_mm_loadu_pd(a + 6), _mm_loadu_pd(b + 6)));
+    }
+
+    // += factor * b[n]
+    void addProducts(double factor, const double * b) {
+        const __m128d factors = _mm_set1_pd(factor);
+        m_values0 = _mm_add_pd(m_values0, _mm_mul_pd(factors, _mm_loadu_pd(b)));
+        m_values1 = _mm_add_pd(m_values1, _mm_mul_pd(factors, _mm_loadu_pd(b + 2)));
+        m_values2 = _mm_add_pd(m_values2, _mm_mul_pd(factors, _mm_loadu_pd(b + 4)));
+        m_values3 = _mm_add_pd(m_values3, _mm_mul_pd(factors, _mm_loadu_pd(b + 6)));
+    }
+
+    void store(double * out) const {
+        _mm_storeu_pd(out, m_values0);
+        _mm_storeu_pd(out + 2, m_values1);
+        _mm_storeu_pd(out + 4, m_values2);
+        _mm_storeu_pd(out + 6, m_values3);
+    }
+
+    __m128d m_values0, m_values1, m_values2, m_values3;
+#else
+    CLaneBlock() : m_values() {}
+
+    void addProducts(const double * a, const double * b) {
+        for ( int n = 0; n < SIZE; ++n ) {
+            m_values[n] += a[n] * b[n];
+        }
+    }
+
+    void addProducts(double factor, const double * b) {
+        for ( int n = 0; n < SIZE; ++n ) {
+            m_values[n] += factor * b[n];
+        }
+    }
+
+    void store(double * out) const {
+        for ( int n = 0; n < SIZE; ++n ) {
+            out[n] = m_values[n];
+        }
+    }
+
+    double m_values[SIZE];
+#endif
+};
+
+/* Many matrices of the same shape, stored interleaved (structure of
+ * arrays): element (r, c) of all matrices lies next to each other in
+ * lane(r, c). The batch kernels work on BLOCK matrices at a time and keep
+ * a CLaneBlock per output element in registers. The capacity is a
+ * multiple of BLOCK, the lanes are padded.
+ */
+template <std::size_t R, std::size_t C>
+class CFixedMatrixBatch {
+public:
+    typedef CFixedMatrix<R, C> Matrix;
+
+    static constexpr std::size_t BLOCK = CLaneBlock::SIZE;
+
+    explicit CFixedMatrixBatch(std::size_t size = 0) : m_size(0), m_capacity(0) {
+        resize(size);
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    // size rounded up to a multiple of BLOCK
+    std::size_t paddedSize() const {
+        return (m_size + BLOCK - 1) / BLOCK * BLOCK;
+    }
+
+    // new matrices are 0
+    void resize(std::size_t size) {
+        reserve(size);
+        for ( std::size_t element = 0; element < R * C; ++element ) {
+            for ( std::size_t i = m_size; i < size; ++i ) {
+                lane(element)[i] = 0.0;
+            }
+        }
+        m_size = size;
+    }
+
+    void reserve(std::size_t capacity) {
+        capacity = (capacity + BLOCK - 1) / BLOCK * BLOCK;
+        if ( capacity <= m_capacity ) {
+            return;
+        }
+        std::vector<double> vecElements(R * C * capacity);
+        for ( std::size_t element = 0; element < R * C; ++element ) {
+            for ( std::size_t i = 0; i < m_size; ++i ) {
+                vecElements[element * capacity + i] = lane(element)[i];
+            }
+        }
+        m_vecElements.swap(vecElements);
+        m_capacity = capacity;
+    }
+
+    void push_back(const Matrix & matrix) {
+        if ( m_size == m_capacity ) {
+            reserve(m_capacity ? 2 * m_capacity : 2 * BLOCK);
+        }
+        ++m_size;
+        set(m_size - 1, matrix);
+    }
+
+    Matrix get(std::size_t index) const {
+        Matrix result;
+        for ( std::size_t element = 0; element < R * C; ++element ) {
+            result.data()[element] = lane(element)[index];
+        }
+        return result;
+    }
+
+    void set(std::size_t index, const Matrix & matrix) {
+        for ( std::size_t element = 0; element < R * C; ++element ) {
+            lane(element)[index] = matrix.data()[element];
+        }
+    }
+
+    // element (row, column) of all matrices, paddedSize() values
+    double * lane(std::size_t row, std::size_t column) {
+        return lane(row * C + column);
+    }
+
+    const double * lane(std::size_t row, std::size_t column) const {
+        return lane(row * C + column);
+    }
+
+private:
+    double * lane(std::size_t element) {
+        return m_vecElements.data() + element * m_capacity;
+    }
+
+    const double * lane(std::size_t element) const {
+        return m_vecElements.data() + element * m_capacity;
+    }
+
+    std::size_t m_size;
+    std::size_t m_capacity;
+    std::vector<double> m_vecElements;
+};
+
+template <std::size_t R, std::size_t C>
+constexpr std::size_t CFixedMatrixBatch<R, C>::BLOCK;
+
+/* The batch kernels write each output lane while still reading the input
+ * lanes. A result which is also an input (multiply(a, b, a), transpose(a, a))
+ * is therefore computed into a temporary batch and moved over: correct, but
+ * with one allocation. */
+template <typename Input, typename Result>
+bool isSameBatch(const Input & input, const Result & result) {
+    return static_cast<const void *>(&input) == static_cast<const void *>(&result);
+}
+
+/* result[n] = a[n] * b[n] for every matrix n of the batches */
+template <std::size_t R, std::size_t K, std::size_t C>
+void multiply(const CFixedMatrixBatch<R, K> & a, const CFixedMatrixBatch<K, C> & b, CFixedMatrixBatch<R, C> & result) {
+    if ( a.size() != b.size() ) {
+        throw std::invalid_argument("multiply: batches of different size");
+    }
+    if ( isSameBatch(a, result) || isSameBatch(b, result) ) {
+        CFixedMatrixBatch<R, C> temporary;
+        multiply(a, b, temporary);
+        result = std::move(temporary);
+        return;
+    }
+    const std::size_t BLOCK = CFixedMatrixBatch<R, C>::BLOCK;
+    result.resize(a.size());
+    for ( std::size_t first = 0; first < a.paddedSize(); first += BLOCK ) {
+        for ( std::size_t i = 0; i < R; ++i ) {
+            for ( std::size_t j = 0; j < C; ++j ) {
+                CLaneBlock sum;
+                CUnroll<K>::apply([&] (std::size_t k) {
+                    sum.addProducts(a.lane(i, k) + first, b.lane(k, j) + first);
+                } );
+                sum.store(result.lane(i, j) + first);
+            }
+        }
+    }
+}
+
+/* result[n] = a * b[n], e.g. one transformation for many matrices */
+template <std::size_t R, std::size_t K, std::size_t C>
+void multiply(const CFixedMatrix<R, K> & a, const CFixedMatrixBatch<K, C> & b, CFixedMatrixBatch<R, C> & result) {
+    if ( isSameBatch(b, result) ) {
+        CFixedMatrixBatch<R, C> temporary;
+        multiply(a, b, temporary);
+        result = std::move(temporary);
+        return;
+    }
+    const std::size_t BLOCK = CFixedMatrixBatch<R, C>::BLOCK;
+    result.resize(b.size());
+    for ( std::size_t first = 0; first < b.paddedSize(); first += BLOCK ) {
+        for ( std::size_t i = 0; i < R; ++i ) {
+            for ( std::size_t j = 0; j < C; ++j ) {
+                CLaneBlock sum;
+                CUnroll<K>::apply([&] (std::size_t k) {
+                    sum.addProducts(a(i, k), b.lane(k, j) + first);
+                } );
+                sum.store(result.lane(i, j) + first);
+            }
+        }
+    }
+}
+
+template <std::size_t R, std::size_t C>
+void transpose(const CFixedMatrixBatch<R, C> & a, CFixedMatrixBatch<C, R> & result) {
+    if ( isSameBatch(a, result) ) {
+        CFixedMatrixBatch<C, R> temporary;
+        transpose(a, temporary);
+        result = std::move(temporary);
+        return;
+    }
+    result.resize(a.size());
+    for ( std::size_t i = 0; i < R; ++i ) {
+        for ( std::size_t j = 0; j < C; ++j ) {
+            const double * pLane = a.lane(i, j);
+            double * pOut = result.lane(j, i);
+            for ( std::size_t n = 0; n < a.size(); ++n ) {
+                pOut[n] = pLane[n];
+            }
+        }
+    }
+}
+
+#endif /* FIXEDMATRIX_H_ */
@@ -0,0 +1,460 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for FlatHashMap.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef FLATHASHMAP_H_
+#define FLATHASHMAP_H_
+
+#include "StringRef.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Open addressing hash map: all entries live in one array, no allocation per
+ * entry.
+ *
+ * Next to the entries there is one control byte per slot: empty, deleted or
+ * the lowest 7 bits of the hash of the key stored there. A lookup compares
+ * the control bytes of a group of 16 slots at once (SSE2) and only looks at
+ * the keys whose 7 bits match. Groups are probed quadratically and the
+ * search stops at the first group with an empty slot.
+ *
+ * find(), count() and at() are templates: with the transparent CFlatHash /
+ * CFlatEqual of std::string keys they accept a CStringRef or string literal.
+ */
+template <typename Key, typename Value, typename Hash = CFlatHash<Key>, typename KeyEqual = CFlatEqual<Key>>
+class CFlatHashMap {
+public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<const Key, Value> value_type;
+    typedef std::size_t size_type;
+
+private:
+    template <bool Const>
+    class CIterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename CFlatHashMap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type *, value_type *>::type pointer;
+        typedef typename std::conditional<Const, const value_type &, value_type &>::type reference;
+
+        CIterator() : m_pMap(nullptr), m_index(0) {}
+        // iterator converts to const_iterator
+        CIterator(const CIterator<false> & other) : m_pMap(other.m_pMap), m_index(other.m_index) {}
+
+        reference operator* () const { return *m_pMap->slot(m_index); }
+        pointer operator-> () const { return m_pMap->slot(m_index); }
+
+        CIterator & operator++ () {
+            m_index = m_pMap->nextFull(m_index + 1);
+            return *this;
+        }
+
+        CIterator operator++ (int) {
+            CIterator result(*this);
+            ++*this;
+            return result;
+        }
+
+        bool operator== (const CIterator & other) const { return m_index == other.m_index; }
+        bool operator!= (const CIterator & other) const { return m_index != other.m_index; }
+
+    private:
+        friend class CFlatHashMap;
+        typedef typename std::conditional<Const, const CFlatHashMap *, CFlatHashMap *>::type MapPointer;
+
+        CIterator(MapPointer pMap, std::size_t index) : m_pMap(pMap), m_index(index) {}
+
+        MapPointer m_pMap;
+        std::size_t m_index;
+    };
+
+public:
+    typedef CIterator<false> iterator;
+    typedef CIterator<true> const_iterator;
+
+    CFlatHashMap() : m_capacity(0), m_size(0), m_deleted(0) {}
+
+    CFlatHashMap(std::initializer_list<value_type> values) : CFlatHashMap() {
+        insert(values.begin(), values.end());
+    }
+
+    template <typename InputIt>
+    CFlatHashMap(InputIt first, InputIt last) : CFlatHashMap() {
+        insert(first, last);
+    }
+
+    CFlatHashMap(const CFlatHashMap & other) : CFlatHashMap() {
+        reserve(other.size());
+        insert(other.begin(), other.end());
+    }
+
+    // noexcept: std::vector<CFlatHashMap> moves instead of copying when it grows
+    CFlatHashMap(CFlatHashMap && other) noexcept : CFlatHashMap() {
+        swap(other);
+    }
+
+    CFlatHashMap & operator= (CFlatHashMap other) {
+        swap(other);
+        return *this;
+    }
+
+    ~CFlatHashMap() {
+        clear();
+    }
+
+    void swap(CFlatHashMap & other) noexcept {
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_size, other.m_size);
+        std::swap(m_deleted, other.m_deleted);
+        m_vecControl.swap(other.m_vecControl);
+        m_pSlots.swap(other.m_pSlots);
+        std::swap(m_hash, other.m_hash);
+        std::swap(m_equal, other.m_equal);
+    }
+
+    iterator begin() { return iterator(this, nextFull(0)); }
+    iterator end() { return iterator(this, m_capacity); }
+    const_iterator begin() const { return const_iterator(this, nextFull(0)); }
+    const_iterator end() const { return const_iterator(this, m_capacity); }
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_type capacity() const { return m_capacity; }
+
+    void clear() {
+        for ( std::size_t i = 0; i < m_capacity; ++i ) {
+            if ( isFull(m_vecControl[i]) ) {
+                slot(i)->~value_type();
+                m_vecControl[i] = EMPTY;
+            }
+        }
+        m_size = 0;
+        m_deleted = 0;
+    }
+
+    // makes room for count entries without rehashing
+    void reserve(size_type count) {
+        if ( count == 0 ) {
+            return;
+        }
+        std::size_t capacity = GROUP_SIZE;
+        while ( capacity * 7 / 8 < count ) {
+            capacity *= 2;
+        }
+        if ( capacity > m_capacity ) {
+            rehash(capacity);
+        }
+    }
+
+    template <typename K>
+    iterator find(const K & key) {
+        return iterator(this, findIndex(key));
+    }
+
+    template <typename K>
+    const_iterator find(const K & key) const {
+        return const_iterator(this, findIndex(key));
+    }
+
+    template <typename K>
+    size_type count(const K & key) const {
+        return findIndex(key) != m_capacity ? 1 : 0;
+    }
+
+    template <typename K>
+    Value & at(const K & key) {
+        std::size_t index = findIndex(key);
+        if ( index == m_capacity ) {
+            throw std::out_of_range("CFlatHashMap::at: key not found");
+        }
+        return slot(index)->second;
+    }
+
+    template <typename K>
+    const Value & at(const K & key) const {
+        return const_cast<CFlatHashMap *>(this)->at(key);
+    }
+
+    Value & operator[] (const Key & key) {
+        return tryEmplace(key).first->second;
+    }
+
+    Value & operator[] (Key && key) {
+        return tryEmplace(std::move(key)).first->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type & value) {
+        return tryEmplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type && value) {
+        return tryEmplace(value.first, std::move(value.second));
+    }
+
+    // bulk insert, reserves up front for forward iterators
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        reserveFor(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        for ( ; first != last; ++first ) {
+            insert(*first);
+        }
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    // only constructs the value if the key is not there yet
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplace(K && key, Args &&... args) {
+        const std::size_t hash = mixedHash(key);
+        std::size_t index = findIndex(key, hash);
+        if ( index != m_capacity ) {
+            return std::make_pair(iterator(this, index), false);
+        }
+        if ( m_size + m_deleted + 1 > m_capacity * 7 / 8 ) {
+            // too many tombstones: same capacity is enough to clean up
+            rehash(m_capacity == 0 ? GROUP_SIZE : (m_size + 1 > m_capacity * 7 / 16 ? 2 * m_capacity : m_capacity));
+        }
+        index = findFree(hash);
+        if ( m_vecControl[index] == DELETED ) {
+            --m_deleted;
+        }
+        new (slot(index)) value_type(std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+        m_vecControl[index] = h2(hash);
+        ++m_size;
+        return std::make_pair(iterator(this, index), true);
+    }
+
+    template <typename K>
+    size_type erase(const K & key) {
+        std::size_t index = findIndex(key);
+        if ( index == m_capacity ) {
+            return 0;
+        }
+        eraseIndex(index);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) {
+        eraseIndex(pos.m_index);
+        return iterator(this, nextFull(pos.m_index + 1));
+    }
+
+    // else erase(find(key)) would pick the key template above
+    iterator erase(iterator pos) {
+        return erase(const_iterator(pos));
+    }
+
+private:
+    typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type Storage;
+
+    static const std::size_t GROUP_SIZE = 16;
+    static const std::int8_t EMPTY = -128;  // 0b10000000
+    static const std::int8_t DELETED = -2;  // 0b11111110, full slots have the high bit cleared
+
+    /* the control bytes of 16 slots; match* return one bit per slot */
+    class CGroup {
+    public:
+#ifdef __SSE2__
+        explicit CGroup(const std::int8_t * pControl) :
+            m_control(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pControl))) {}
+
+        std::uint32_t match(std::int8_t h2) const {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_control));
+        }
+
+        std::uint32_t matchEmpty() const {
+            return match(EMPTY);
+        }
+
+        std::uint32_t matchEmptyOrDeleted() const {
+            return _mm_movemask_epi8(m_control);
+        }
+
+    private:
+        __m128i m_control;
+#else
+        explicit CGroup(const std::int8_t * pControl) : m_pControl(pControl) {}
+
+        std::uint32_t match(std::int8_t h2) const {
+            std::uint32_t result = 0;
+            for ( std::size_t i = 0; i < GROUP_SIZE; ++i ) {
+                result |= std::uint32_t(m_pControl[i] == h2) << i;
+            }
+            return result;
+        }
+
+        std::uint32_t matchEmpty() const {
+            return match(EMPTY);
+        }
+
+        std::uint32_t matchEmptyOrDeleted() const {
+            std::uint32_t result = 0;
+            for ( std::size_t i = 0; i < GROUP_SIZE; ++i ) {
+                result |= std::uint32_t(m_pControl[i] < 0) << i;
+            }
+            return result;
+        }
+
+    private:
+        const std::int8_t * m_pControl;
+#endif
+    };
+
+    static bool isFull(std::int8_t control) {
+        return control >= 0;
+    }
+
+    static std::int8_t h2(std::size_t hash) {
+        return static_cast<std::int8_t>(hash & 0x7f);
+    }
+
+    // spreads weak hashes (std::hash<int> is the identity) over all bits
+    template <typename K>
+    std::size_t mixedHash(const K & key) const {
+        std::uint64_t hash = m_hash(key);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return static_cast<std::size_t>(hash);
+    }
+
+    value_type * slot(std::size_t index) {
+        return reinterpret_cast<value_type *>(&m_pSlots[index]);
+    }
+
+    const value_type * slot(std::size_t index) const {
+        return reinterpret_cast<const value_type *>(&m_pSlots[index]);
+    }
+
+    std::size_t nextFull(std::size_t index) const {
+        while ( index < m_capacity && !isFull(m_vecControl[index]) ) {
+            ++index;
+        }
+        return index;
+    }
+
+    template <typename K>
+    std::size_t findIndex(const K & key) const {
+        return m_capacity ? findIndex(key, mixedHash(key)) : m_capacity;
+    }
+
+    // returns m_capacity if not found
+    template <typename K>
+    std::size_t findIndex(const K & key, std::size_t hash) const {
+        if ( m_capacity == 0 ) {
+            return m_capacity;
+        }
+        const std::size_t groupMask = m_capacity / GROUP_SIZE - 1;
+        std::size_t group = (hash >> 7) & groupMask;
+        for ( std::size_t step = 1; ; ++step ) {
+            CGroup controls(&m_vecControl[group * GROUP_SIZE]);
+            for ( std::uint32_t matches = controls.match(h2(hash)); matches; matches &= matches - 1 ) {
+                std::size_t index = group * GROUP_SIZE + __builtin_ctz(matches);
+                if ( m_equal(slot(index)->first, key) ) {
+                    return index;
+                }
+            }
+            if ( controls.matchEmpty() ) {
+                return m_capacity;
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    // first empty or deleted slot on the probe sequence of hash
+    std::size_t findFree(std::size_t hash) const {
+        const std::size_t groupMask = m_capacity / GROUP_SIZE - 1;
+        std::size_t group = (hash >> 7) & groupMask;
+        for ( std::size_t step = 1; ; ++step ) {
+            std::uint32_t free = CGroup(&m_vecControl[group * GROUP_SIZE]).matchEmptyOrDeleted();
+            if ( free ) {
+                return group * GROUP_SIZE + __builtin_ctz(free);
+            }
+            group = (group + step) & groupMask;
+        }
+    }
+
+    void eraseIndex(std::size_t index) {
+        slot(index)->~value_type();
+        m_vecControl[index] = DELETED;
+        --m_size;
+        ++m_deleted;
+    }
+
+    void rehash(std::size_t capacity) {
+        std::vector<std::int8_t> vecOldControl(capacity, EMPTY);
+        std::unique_ptr<Storage[]> pOldSlots(new Storage[capacity]);
+        vecOldControl.swap(m_vecControl);
+        pOldSlots.swap(m_pSlots);
+        std::size_t oldCapacity = m_capacity;
+        m_capacity = capacity;
+        m_deleted = 0;
+
+        for ( std::size_t i = 0; i < oldCapacity; ++i ) {
+            if ( isFull(vecOldControl[i]) ) {
+                value_type * pOld = reinterpret_cast<value_type *>(&pOldSlots[i]);
+                std::size_t hash = mixedHash(pOld->first);
+                std::size_t index = findFree(hash);
+                new (slot(index)) value_type(std::move(*pOld));
+                m_vecControl[index] = h2(hash);
+                pOld->~value_type();
+            }
+        }
+    }
+
+    template <typename InputIt>
+    void reserveFor(InputIt first, InputIt last, std::forward_iterator_tag) {
+        reserve(m_size + std::distance(first, last));
+    }
+
+    template <typename InputIt>
+    void reserveFor(InputIt, InputIt, std::input_iterator_tag) {}
+
+    std::size_t m_capacity;  // 0 or a power of two >= GROUP_SIZE
+    std::size_t m_size;
+    std::size_t m_deleted;
+    std::vector<std::int8_t> m_vecControl;
+    std::unique_ptr<Storage[]> m_pSlots;
+    Hash m_hash;
+    KeyEqual m_equal;
+};
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+const std::size_t CFlatHashMap<Key, Value, Hash, KeyEqual>::GROUP_SIZE;
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+const std::int8_t CFlatHashMap<Key, Value, Hash, KeyEqual>::EMPTY;
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+const std::int8_t CFlatHashMap<Key, Value, Hash, KeyEqual>::DELETED;
+
+#endif /* FLATHASHMAP_H_ */
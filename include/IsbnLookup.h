@@ -0,0 +1,240 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for IsbnLookup.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef ISBNLOOKUP_H_
+#define ISBNLOOKUP_H_
+
+#include "LruCache.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* the (remote) service behind Library::Lookup */
+class CIsbnService {
+public:
+    virtual ~CIsbnService() {}
+
+    // one call for all isbns, returns the book names in the same order
+    virtual std::vector<std::string> lookupMany(const std::vector<std::string> & vecIsbns) = 0;
+};
+
+/* Cache in front of a CIsbnService.
+ *
+ * The cache holds a std::shared_future per isbn, ready or still pending:
+ *  - ready: a hit, no backend call
+ *  - pending: somebody already asked for this isbn, the request is
+ *    collapsed onto the running fetch
+ *  - missing: a promise is inserted and the isbn is queued for fetching
+ * lookupMany() returns futures right away. One dispatcher thread fetches
+ * the queued misses of all callers: it waits up to a batch window after
+ * the first miss arrives (or until MAX_BATCH are queued) and fetches them
+ * all with one backend call. While that call runs, the next batch queues
+ * up. Failed fetches are removed from the cache again, so the next lookup
+ * retries; but only the entries still holding the failed batch's own
+ * pending future, not values the batch already delivered nor a newer
+ * fetch of the same isbn started after an eviction.
+ */
+class CCachingIsbnLookup {
+public:
+    typedef std::shared_future<std::string> BookName;
+
+    enum { MAX_BATCH = 256, DEFAULT_WINDOW_US = 200 };
+
+    struct CStats {
+        std::size_t m_hits;
+        std::size_t m_collapsed;
+        std::size_t m_misses;
+        std::size_t m_backendCalls;
+
+        // requests answered from the cache, without waiting
+        double hitRate() const {
+            return rate(m_hits);
+        }
+
+        // requests which waited for a fetch somebody else started
+        double collapsedRate() const {
+            return rate(m_collapsed);
+        }
+
+    private:
+        double rate(std::size_t count) const {
+            std::size_t total = m_hits + m_collapsed + m_misses;
+            return total ? static_cast<double>(count) / total : 0.0;
+        }
+    };
+
+    CCachingIsbnLookup(CIsbnService & service, std::size_t capacity, std::size_t shards = 16,
+                       std::chrono::microseconds window = std::chrono::microseconds(DEFAULT_WINDOW_US)) :
+        m_service(service),
+        m_cache(capacity, shards),
+        m_window(window),
+        m_bStop(false),
+        m_hits(0), m_collapsed(0), m_misses(0), m_backendCalls(0) {
+        m_dispatcher = std::thread([this] () { dispatch(); });
+    }
+
+    // fetches what is still queued, then stops the dispatcher
+    ~CCachingIsbnLookup() {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            m_bStop = true;
+        }
+        m_queueChanged.notify_one();
+        m_dispatcher.join();
+    }
+
+    CCachingIsbnLookup(const CCachingIsbnLookup &) = delete;
+    CCachingIsbnLookup & operator=(const CCachingIsbnLookup &) = delete;
+
+    std::string lookup(const std::string & isbn) {
+        PROFILE_SCOPE("CCachingIsbnLookup::lookup");
+        return lookupMany(std::vector<std::string>{ isbn })[0].get();
+    }
+
+    std::vector<BookName> lookupMany(const std::vector<std::string> & vecIsbns) {
+        PROFILE_SCOPE("CCachingIsbnLookup::lookupMany");
+        std::vector<BookName> vecResult;
+        vecResult.reserve(vecIsbns.size());
+        std::vector<CMiss> vecMisses;
+
+        for ( auto& isbn : vecIsbns ) {
+            std::shared_ptr<std::promise<std::string>> pPromise;
+            auto cached = m_cache.findOrInsert(isbn, [&pPromise] () {
+                pPromise = std::make_shared<std::promise<std::string>>();
+                return CEntry{ pPromise->get_future().share(), pPromise.get() };
+            } );
+            if ( cached.second ) {
+                vecMisses.push_back(CMiss{ isbn, std::move(pPromise) });
+                ++m_misses;
+            }
+            else if ( isReady(cached.first.m_name) ) {
+                ++m_hits;
+            }
+            else {
+                ++m_collapsed;
+            }
+            vecResult.push_back(std::move(cached.first.m_name));
+        }
+
+        if ( !vecMisses.empty() ) {
+            {
+                std::lock_guard<std::mutex> lock(m_queueMutex);
+                std::move(vecMisses.begin(), vecMisses.end(), std::back_inserter(m_vecQueue));
+            }
+            m_queueChanged.notify_one();
+        }
+        return vecResult;
+    }
+
+    CStats stats() const {
+        return CStats{ m_hits.load(), m_collapsed.load(), m_misses.load(), m_backendCalls.load() };
+    }
+
+private:
+    // m_pPromise identifies the fetch which fulfils m_name
+    struct CEntry {
+        BookName m_name;
+        const std::promise<std::string> * m_pPromise;
+    };
+
+    struct CMiss {
+        std::string m_isbn;
+        std::shared_ptr<std::promise<std::string>> m_pPromise;
+    };
+
+    // the dispatcher thread
+    void dispatch() {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        for (;;) {
+            m_queueChanged.wait(lock, [this] () { return m_bStop || !m_vecQueue.empty(); });
+            if ( m_vecQueue.empty() ) {
+                return;
+            }
+            // give other callers the window to add their misses to this batch
+            m_queueChanged.wait_until(lock, std::chrono::steady_clock::now() + m_window, [this] () {
+                return m_bStop || m_vecQueue.size() >= MAX_BATCH;
+            } );
+            const std::size_t count = std::min<std::size_t>(MAX_BATCH, m_vecQueue.size());
+            std::vector<CMiss> vecBatch(std::make_move_iterator(m_vecQueue.begin()),
+                                        std::make_move_iterator(m_vecQueue.begin() + count));
+            m_vecQueue.erase(m_vecQueue.begin(), m_vecQueue.begin() + count);
+            lock.unlock();
+            fetch(vecBatch);
+            lock.lock();
+        }
+    }
+
+    void fetch(const std::vector<CMiss> & vecBatch) {
+        PROFILE_SCOPE("CIsbnService::lookupMany");
+        PROFILE_COUNT("CIsbnService::isbns", vecBatch.size());
+        ++m_backendCalls;
+        std::vector<std::string> vecIsbns;
+        vecIsbns.reserve(vecBatch.size());
+        for ( auto& miss : vecBatch ) {
+            vecIsbns.push_back(miss.m_isbn);
+        }
+        try {
+            std::vector<std::string> vecNames = m_service.lookupMany(vecIsbns);
+            for ( std::size_t i = 0; i < vecBatch.size(); ++i ) {
+                vecBatch[i].m_pPromise->set_value(std::move(vecNames.at(i)));
+            }
+        }
+        catch ( ... ) {
+            for ( auto& miss : vecBatch ) {
+                const std::promise<std::string> * pPromise = miss.m_pPromise.get();
+                m_cache.eraseIf(miss.m_isbn, [pPromise] (const CEntry & entry) {
+                    return entry.m_pPromise == pPromise && !isReady(entry.m_name);
+                } );
+                try {
+                    miss.m_pPromise->set_exception(std::current_exception());
+                }
+                catch ( const std::future_error & ) {
+                    // already has a value (backend returned too few names)
+                }
+            }
+        }
+    }
+
+    static bool isReady(const BookName & name) {
+        return name.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    CIsbnService & m_service;
+    CShardedLruCache<std::string, CEntry> m_cache;
+    const std::chrono::microseconds m_window;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueChanged;
+    std::vector<CMiss> m_vecQueue;  // misses not yet handed to the backend
+    bool m_bStop;
+    std::atomic<std::size_t> m_hits;
+    std::atomic<std::size_t> m_collapsed;
+    std::atomic<std::size_t> m_misses;
+    std::atomic<std::size_t> m_backendCalls;
+    std::thread m_dispatcher;
+};
+
+#endif /* ISBNLOOKUP_H_ */
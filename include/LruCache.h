@@ -0,0 +1,158 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for LruCache.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef LRUCACHE_H_
+#define LRUCACHE_H_
+
+#include "FlatHashMap.h"
+#include "StringRef.h"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/* Thread safe least recently used cache. The keys are spread over shards,
+ * each with its own mutex, list (most recently used first) and index, so
+ * threads working on different keys rarely wait for each other.
+ */
+template <typename Key, typename Value, typename Hash = CFlatHash<Key>>
+class CShardedLruCache {
+public:
+    CShardedLruCache(std::size_t capacity, std::size_t shards = 16) :
+        m_vecShards(checkedShards(capacity, shards)) {
+        for ( auto& pShard : m_vecShards ) {
+            pShard.reset(new CShard((capacity + shards - 1) / shards));
+        }
+    }
+
+    // copies the value and marks the entry as most recently used
+    bool find(const Key & key, Value & value) {
+        CShard & shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m_mutex);
+        auto itr = shard.m_mapIndex.find(key);
+        if ( itr == shard.m_mapIndex.end() ) {
+            return false;
+        }
+        shard.touch(itr->second);
+        value = itr->second->second;
+        return true;
+    }
+
+    /* returns the cached value and false, or inserts makeValue() and returns
+     * it and true; atomic with respect to other callers for the same key */
+    template <typename MakeValue>
+    std::pair<Value, bool> findOrInsert(const Key & key, MakeValue makeValue) {
+        CShard & shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m_mutex);
+        auto itr = shard.m_mapIndex.find(key);
+        if ( itr != shard.m_mapIndex.end() ) {
+            shard.touch(itr->second);
+            return std::make_pair(itr->second->second, false);
+        }
+        shard.insert(key, makeValue());
+        return std::make_pair(shard.m_listEntries.front().second, true);
+    }
+
+    void insert(const Key & key, Value value) {
+        CShard & shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m_mutex);
+        auto itr = shard.m_mapIndex.find(key);
+        if ( itr != shard.m_mapIndex.end() ) {
+            shard.touch(itr->second);
+            itr->second->second = std::move(value);
+            return;
+        }
+        shard.insert(key, std::move(value));
+    }
+
+    void erase(const Key & key) {
+        CShard & shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m_mutex);
+        auto itr = shard.m_mapIndex.find(key);
+        if ( itr != shard.m_mapIndex.end() ) {
+            shard.m_listEntries.erase(itr->second);
+            shard.m_mapIndex.erase(key);
+        }
+    }
+
+    // erases the entry of key only if pred(value) is true
+    template <typename Pred>
+    bool eraseIf(const Key & key, Pred pred) {
+        CShard & shard = shardOf(key);
+        std::lock_guard<std::mutex> lock(shard.m_mutex);
+        auto itr = shard.m_mapIndex.find(key);
+        if ( itr == shard.m_mapIndex.end() || !pred(static_cast<const Value &>(itr->second->second)) ) {
+            return false;
+        }
+        shard.m_listEntries.erase(itr->second);
+        shard.m_mapIndex.erase(key);
+        return true;
+    }
+
+    std::size_t size() const {
+        std::size_t result = 0;
+        for ( auto& pShard : m_vecShards ) {
+            std::lock_guard<std::mutex> lock(pShard->m_mutex);
+            result += pShard->m_listEntries.size();
+        }
+        return result;
+    }
+
+private:
+    typedef std::list<std::pair<Key, Value>> EntryList;
+
+    struct CShard {
+        explicit CShard(std::size_t capacity) : m_capacity(capacity) {
+            m_mapIndex.reserve(capacity + 1);
+        }
+
+        void touch(typename EntryList::iterator itr) {
+            m_listEntries.splice(m_listEntries.begin(), m_listEntries, itr);
+        }
+
+        void insert(const Key & key, Value value) {
+            m_listEntries.emplace_front(key, std::move(value));
+            m_mapIndex[key] = m_listEntries.begin();
+            if ( m_listEntries.size() > m_capacity ) {
+                m_mapIndex.erase(m_listEntries.back().first);
+                m_listEntries.pop_back();
+            }
+        }
+
+        std::size_t m_capacity;
+        mutable std::mutex m_mutex;
+        EntryList m_listEntries;
+        CFlatHashMap<Key, typename EntryList::iterator, Hash> m_mapIndex;
+    };
+
+    static std::size_t checkedShards(std::size_t capacity, std::size_t shards) {
+        if ( capacity == 0 || shards == 0 ) {
+            throw std::invalid_argument("CShardedLruCache: capacity and shards must not be 0");
+        }
+        return shards;
+    }
+
+    CShard & shardOf(const Key & key) {
+        return *m_vecShards[(m_hash(key) >> 16) % m_vecShards.size()];
+    }
+
+    std::vector<std::unique_ptr<CShard>> m_vecShards;
+    Hash m_hash;
+};
+
+#endif /* LRUCACHE_H_ */
@@ -0,0 +1,109 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for Matrix.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef MATRIX_H_
+#define MATRIX_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/* use this class also to play with default and delete */
+
+class CMatrix {
+public:
+    CMatrix(const CMatrix & matrix); // copy constructor
+    CMatrix(CMatrix && matrix) noexcept; // move constructor
+    CMatrix& operator=(const CMatrix & matrix) = default; // copy assignment
+    CMatrix& operator=(CMatrix && matrix) noexcept; // move assignment
+
+    CMatrix(std::size_t rows, std::size_t columns);
+    CMatrix & operator* (CMatrix const & other) const; // used for demonstrating copy, defined in Move.cpp
+//    CMatrix operator* (CMatrix const & other) const; // used for move
+
+    std::size_t rows() const;
+    std::size_t columns() const;
+    std::vector<double> elements() const;
+
+    // row major, no copy
+    double & operator() (std::size_t row, std::size_t column);
+    double operator() (std::size_t row, std::size_t column) const;
+    double * data();
+    const double * data() const;
+
+private:
+    std::size_t m_columns;
+    std::size_t m_rows;
+    std::vector<double> m_elements;
+};
+
+/* needed stuff */
+inline CMatrix::CMatrix(const CMatrix & matrix) :
+    m_columns(matrix.columns()),
+    m_rows(matrix.rows()),
+    m_elements(matrix.elements()) {}
+
+// takes the elements, leaves an empty 0 x 0 matrix behind
+inline CMatrix::CMatrix(CMatrix && matrix) noexcept :
+    m_columns(matrix.m_columns),
+    m_rows(matrix.m_rows),
+    m_elements(std::move(matrix.m_elements)) { // not matrix.elements(): that is a copy
+    matrix.m_columns = 0;
+    matrix.m_rows = 0;
+}
+
+inline CMatrix & CMatrix::operator=(CMatrix && matrix) noexcept {
+    m_columns = matrix.m_columns;
+    m_rows = matrix.m_rows;
+    m_elements = std::move(matrix.m_elements);
+    matrix.m_columns = 0;
+    matrix.m_rows = 0;
+    matrix.m_elements.clear();
+    return *this;
+}
+
+inline CMatrix::CMatrix(std::size_t rows, std::size_t columns) :
+        m_columns(columns),
+        m_rows(rows),
+        m_elements(std::vector<double>(rows*columns)) {}
+
+inline std::size_t CMatrix::rows() const {
+    return m_rows;
+}
+
+inline std::size_t CMatrix::columns() const {
+    return m_columns;
+}
+
+inline std::vector<double> CMatrix::elements() const {
+    return m_elements;
+}
+
+inline double & CMatrix::operator() (std::size_t row, std::size_t column) {
+    return m_elements[row * m_columns + column];
+}
+
+inline double CMatrix::operator() (std::size_t row, std::size_t column) const {
+    return m_elements[row * m_columns + column];
+}
+
+inline double * CMatrix::data() {
+    return m_elements.data();
+}
+
+inline const double * CMatrix::data() const {
+    return m_elements.data();
+}
+
+#endif /* MATRIX_H_ */
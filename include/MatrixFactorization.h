@@ -0,0 +1,405 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for MatrixFactorization.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef MATRIXFACTORIZATION_H_
+#define MATRIXFACTORIZATION_H_
+
+#include "Matrix.h"
+#include "TiledMultiply.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Blocked right-looking factorizations of a square CMatrix.
+ *
+ * The matrix is factorized once in the constructor, solve() can then be
+ * called for any number of right hand sides. Per block of blockSize
+ * columns only a thin panel is factorized element by element; the update
+ * of the trailing matrix, where nearly all the work is, goes through
+ * CTiledMultiply and runs in parallel. With blockSize >= rows the whole
+ * matrix is one panel, which is the textbook unblocked algorithm.
+ */
+class CFactorization {
+public:
+    enum { DEFAULT_BLOCK_SIZE = 128 };
+
+    std::size_t size() const {
+        return m_matrix.rows();
+    }
+
+protected:
+    CFactorization(CMatrix matrix, std::size_t blockSize, const char * name) :
+        m_matrix(std::move(matrix)),
+        m_blockSize(std::max<std::size_t>(1, std::min(blockSize, m_matrix.rows()))) {
+        if ( m_matrix.rows() != m_matrix.columns() ) {
+            throw std::invalid_argument(std::string(name) + ": matrix not square");
+        }
+    }
+
+    void checkRows(std::size_t rows, const char * name) const {
+        if ( rows != size() ) {
+            throw std::invalid_argument(std::string(name) + ": right hand side has the wrong size");
+        }
+    }
+
+    double * row(std::size_t index) {
+        return m_matrix.data() + index * size();
+    }
+
+    const double * row(std::size_t index) const {
+        return m_matrix.data() + index * size();
+    }
+
+    // pTo[i] -= factor * pFrom[i]
+    static void subtractRow(double * pTo, const double * pFrom, double factor, std::size_t count) {
+        for ( std::size_t i = 0; i < count; ++i ) {
+            pTo[i] -= factor * pFrom[i];
+        }
+    }
+
+    static void scaleRow(double * pRow, double factor, std::size_t count) {
+        for ( std::size_t i = 0; i < count; ++i ) {
+            pRow[i] *= factor;
+        }
+    }
+
+    // rows x columns block at pFrom (row distance ldFrom) into a columns x rows matrix
+    static void transposeBlock(std::size_t rows, std::size_t columns, const double * pFrom, std::size_t ldFrom,
+                               std::vector<double> & vecTo) {
+        vecTo.resize(rows * columns);
+        for ( std::size_t i = 0; i < rows; ++i ) {
+            for ( std::size_t j = 0; j < columns; ++j ) {
+                vecTo[j * rows + i] = pFrom[i * ldFrom + j];
+            }
+        }
+    }
+
+    CMatrix m_matrix;
+    std::size_t m_blockSize;
+};
+
+/* P A = L U with scaled partial pivoting (row exchanges), L with unit
+ * diagonal below, U on and above the diagonal of one matrix. Throws
+ * std::domain_error if the matrix is singular: like in
+ * CFixedMatrix::inverse(), a pivot below n * epsilon * the largest element
+ * of its row counts as 0. */
+class CLuFactorization : public CFactorization {
+public:
+    explicit CLuFactorization(CMatrix matrix, std::size_t blockSize = DEFAULT_BLOCK_SIZE) :
+        CFactorization(std::move(matrix), blockSize, "CLuFactorization"),
+        m_vecPivots(size()) {
+        const std::size_t n = size();
+        std::vector<double> vecTolerances(n);
+        for ( std::size_t i = 0; i < n; ++i ) {
+            double largest = 0.0;
+            for ( std::size_t j = 0; j < n; ++j ) {
+                largest = std::max(largest, std::abs(m_matrix(i, j)));
+            }
+            vecTolerances[i] = n * std::numeric_limits<double>::epsilon() * largest;
+        }
+        for ( std::size_t first = 0; first < n; first += m_blockSize ) {
+            const std::size_t width = std::min(m_blockSize, n - first);
+            const std::size_t next = first + width;
+            factorPanel(first, width, vecTolerances);
+            if ( next < n ) {
+                solveUpperPanel(first, width);
+                CTiledMultiply::multiplyAdd(n - next, n - next, width, -1.0,
+                                            row(next) + first, n, row(first) + next, n, row(next) + next, n);
+            }
+        }
+    }
+
+    /* the product of the diagonal of U: over- or underflows for larger
+     * matrices already, e.g. to inf for 150 x 150 with a diagonal of 150;
+     * logAbsDeterminant() and determinantSign() do not */
+    double determinant() const {
+        double result = 1.0;
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            result *= m_vecPivots[i] == i ? m_matrix(i, i) : -m_matrix(i, i);
+        }
+        return result;
+    }
+
+    // log |det A|, the sum of the logs instead of the product
+    double logAbsDeterminant() const {
+        double result = 0.0;
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            result += std::log(std::abs(m_matrix(i, i)));
+        }
+        return result;
+    }
+
+    // -1 or 1
+    int determinantSign() const {
+        int result = 1;
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            if ( (m_vecPivots[i] != i) != (m_matrix(i, i) < 0.0) ) {
+                result = -result;
+            }
+        }
+        return result;
+    }
+
+    std::vector<double> solve(std::vector<double> vecB) const {
+        checkRows(vecB.size(), "CLuFactorization::solve");
+        solveInPlace(vecB.data(), 1);
+        return vecB;
+    }
+
+    // every column of b is a right hand side
+    CMatrix solve(CMatrix b) const {
+        checkRows(b.rows(), "CLuFactorization::solve");
+        solveInPlace(b.data(), b.columns());
+        return b;
+    }
+
+    CMatrix inverse() const {
+        CMatrix result(size(), size());
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            result(i, i) = 1.0;
+        }
+        return solve(std::move(result));
+    }
+
+private:
+    /* unblocked elimination of columns [first, first + width), exchanges
+     * whole rows and their tolerances */
+    void factorPanel(std::size_t first, std::size_t width, std::vector<double> & vecTolerances) {
+        const std::size_t n = size();
+        for ( std::size_t j = first; j < first + width; ++j ) {
+            // the largest pivot relative to its row
+            std::size_t pivot = j;
+            for ( std::size_t i = j + 1; i < n; ++i ) {
+                if ( std::abs(m_matrix(i, j)) * vecTolerances[pivot] > std::abs(m_matrix(pivot, j)) * vecTolerances[i] ) {
+                    pivot = i;
+                }
+            }
+            if ( std::abs(m_matrix(pivot, j)) <= vecTolerances[pivot] ) {
+                throw std::domain_error("CLuFactorization: singular matrix");
+            }
+            m_vecPivots[j] = pivot;
+            if ( pivot != j ) {
+                std::swap_ranges(row(j), row(j) + n, row(pivot));
+                std::swap(vecTolerances[j], vecTolerances[pivot]);
+            }
+            const double scale = 1.0 / m_matrix(j, j);
+            for ( std::size_t i = j + 1; i < n; ++i ) {
+                double & factor = m_matrix(i, j);
+                factor *= scale;
+                subtractRow(row(i) + j + 1, row(j) + j + 1, factor, first + width - j - 1);
+            }
+        }
+    }
+
+    // U of the rows [first, first + width) right of the panel, column blocks in parallel
+    void solveUpperPanel(std::size_t first, std::size_t width) {
+        const std::size_t next = first + width;
+        const std::size_t columns = size() - next;
+        const std::size_t blockColumns = CTiledMultiply::TILE_N;
+        parallelBlocks((columns + blockColumns - 1) / blockColumns, [=] (std::size_t block) {
+            const std::size_t column = next + block * blockColumns;
+            const std::size_t count = std::min(blockColumns, size() - column);
+            for ( std::size_t i = first + 1; i < next; ++i ) {
+                for ( std::size_t r = first; r < i; ++r ) {
+                    subtractRow(row(i) + column, row(r) + column, m_matrix(i, r), count);
+                }
+            }
+        } );
+    }
+
+    // b = U^-1 L^-1 P b, blockwise: everything off the diagonal blocks is a multiply
+    void solveInPlace(double * pB, std::size_t columns) const {
+        const std::size_t n = size();
+        for ( std::size_t i = 0; i < n; ++i ) {
+            if ( m_vecPivots[i] != i ) {
+                std::swap_ranges(pB + i * columns, pB + (i + 1) * columns, pB + m_vecPivots[i] * columns);
+            }
+        }
+        for ( std::size_t first = 0; first < n; first += m_blockSize ) {
+            const std::size_t next = std::min(first + m_blockSize, n);
+            CTiledMultiply::multiplyAdd(next - first, columns, first, -1.0,
+                                        row(first), n, pB, columns, pB + first * columns, columns);
+            for ( std::size_t i = first + 1; i < next; ++i ) {
+                for ( std::size_t r = first; r < i; ++r ) {
+                    subtractRow(pB + i * columns, pB + r * columns, m_matrix(i, r), columns);
+                }
+            }
+        }
+        for ( std::size_t next = n; next > 0; ) {
+            const std::size_t first = next > m_blockSize ? next - m_blockSize : 0;
+            CTiledMultiply::multiplyAdd(next - first, columns, n - next, -1.0,
+                                        row(first) + next, n, pB + next * columns, columns, pB + first * columns, columns);
+            for ( std::size_t i = next; i-- > first; ) {
+                for ( std::size_t r = i + 1; r < next; ++r ) {
+                    subtractRow(pB + i * columns, pB + r * columns, m_matrix(i, r), columns);
+                }
+                scaleRow(pB + i * columns, 1.0 / m_matrix(i, i), columns);
+            }
+            next = first;
+        }
+    }
+
+    // row j was exchanged with row m_vecPivots[j] >= j
+    std::vector<std::size_t> m_vecPivots;
+};
+
+/* A = L L^T for a symmetric positive definite A, only the lower triangle
+ * is read and L is stored there. Throws std::domain_error if the matrix is
+ * not positive definite. */
+class CCholeskyFactorization : public CFactorization {
+public:
+    explicit CCholeskyFactorization(CMatrix matrix, std::size_t blockSize = DEFAULT_BLOCK_SIZE) :
+        CFactorization(std::move(matrix), blockSize, "CCholeskyFactorization") {
+        const std::size_t n = size();
+        std::vector<double> vecTransposed;
+        for ( std::size_t first = 0; first < n; first += m_blockSize ) {
+            const std::size_t width = std::min(m_blockSize, n - first);
+            const std::size_t next = first + width;
+            factorDiagonal(first, width);
+            if ( next < n ) {
+                solveLowerPanel(first, width);
+                // lower triangle of the trailing matrix -= L21 L21^T, by row blocks
+                const std::size_t rows = n - next;
+                transposeBlock(rows, width, row(next) + first, n, vecTransposed);
+                const double * pTransposed = vecTransposed.data();
+                const std::size_t blockRows = m_blockSize;
+                parallelBlocks((rows + blockRows - 1) / blockRows, [=] (std::size_t block) {
+                    const std::size_t begin = block * blockRows;
+                    const std::size_t end = std::min(begin + blockRows, rows);
+                    CTiledMultiply::multiplyAddSerial(end - begin, end, width, -1.0,
+                                                      row(next + begin) + first, n, pTransposed, rows,
+                                                      row(next + begin) + next, n);
+                } );
+            }
+        }
+    }
+
+    // over- or underflows like CLuFactorization::determinant()
+    double determinant() const {
+        double result = 1.0;
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            result *= m_matrix(i, i) * m_matrix(i, i);
+        }
+        return result;
+    }
+
+    // log det A, the determinant is always positive
+    double logDeterminant() const {
+        double result = 0.0;
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            result += 2.0 * std::log(m_matrix(i, i));
+        }
+        return result;
+    }
+
+    std::vector<double> solve(std::vector<double> vecB) const {
+        checkRows(vecB.size(), "CCholeskyFactorization::solve");
+        solveInPlace(vecB.data(), 1);
+        return vecB;
+    }
+
+    // every column of b is a right hand side
+    CMatrix solve(CMatrix b) const {
+        checkRows(b.rows(), "CCholeskyFactorization::solve");
+        solveInPlace(b.data(), b.columns());
+        return b;
+    }
+
+    CMatrix inverse() const {
+        CMatrix result(size(), size());
+        for ( std::size_t i = 0; i < size(); ++i ) {
+            result(i, i) = 1.0;
+        }
+        return solve(std::move(result));
+    }
+
+private:
+    // unblocked right-looking factorization of the diagonal block
+    void factorDiagonal(std::size_t first, std::size_t width) {
+        for ( std::size_t j = first; j < first + width; ++j ) {
+            if ( !(m_matrix(j, j) > 0.0) ) {
+                throw std::domain_error("CCholeskyFactorization: matrix not positive definite");
+            }
+            const double diagonal = std::sqrt(m_matrix(j, j));
+            m_matrix(j, j) = diagonal;
+            for ( std::size_t i = j + 1; i < first + width; ++i ) {
+                m_matrix(i, j) /= diagonal;
+            }
+            for ( std::size_t i = j + 1; i < first + width; ++i ) {
+                for ( std::size_t c = j + 1; c <= i; ++c ) {
+                    m_matrix(i, c) -= m_matrix(i, j) * m_matrix(c, j);
+                }
+            }
+        }
+    }
+
+    // L21 = A21 L11^-T below the diagonal block, row blocks in parallel
+    void solveLowerPanel(std::size_t first, std::size_t width) {
+        const std::size_t next = first + width;
+        const std::size_t rows = size() - next;
+        const std::size_t blockRows = CTiledMultiply::ROWS_PER_BLOCK;
+        parallelBlocks((rows + blockRows - 1) / blockRows, [=] (std::size_t block) {
+            const std::size_t end = std::min(next + (block + 1) * blockRows, size());
+            for ( std::size_t i = next + block * blockRows; i < end; ++i ) {
+                for ( std::size_t j = first; j < next; ++j ) {
+                    double sum = m_matrix(i, j);
+                    for ( std::size_t r = first; r < j; ++r ) {
+                        sum -= m_matrix(i, r) * m_matrix(j, r);
+                    }
+                    m_matrix(i, j) = sum / m_matrix(j, j);
+                }
+            }
+        } );
+    }
+
+    // b = L^-T L^-1 b, blockwise like CLuFactorization
+    void solveInPlace(double * pB, std::size_t columns) const {
+        const std::size_t n = size();
+        for ( std::size_t first = 0; first < n; first += m_blockSize ) {
+            const std::size_t next = std::min(first + m_blockSize, n);
+            CTiledMultiply::multiplyAdd(next - first, columns, first, -1.0,
+                                        row(first), n, pB, columns, pB + first * columns, columns);
+            for ( std::size_t i = first; i < next; ++i ) {
+                for ( std::size_t r = first; r < i; ++r ) {
+                    subtractRow(pB + i * columns, pB + r * columns, m_matrix(i, r), columns);
+                }
+                scaleRow(pB + i * columns, 1.0 / m_matrix(i, i), columns);
+            }
+        }
+        // L^T is not stored, the columns below each diagonal block are transposed on the way
+        std::vector<double> vecTransposed;
+        for ( std::size_t next = n; next > 0; ) {
+            const std::size_t first = next > m_blockSize ? next - m_blockSize : 0;
+            transposeBlock(n - next, next - first, row(next) + first, n, vecTransposed);
+            CTiledMultiply::multiplyAdd(next - first, columns, n - next, -1.0,
+                                        vecTransposed.data(), n - next, pB + next * columns, columns,
+                                        pB + first * columns, columns);
+            for ( std::size_t i = next; i-- > first; ) {
+                for ( std::size_t r = i + 1; r < next; ++r ) {
+                    subtractRow(pB + i * columns, pB + r * columns, m_matrix(r, i), columns);
+                }
+                scaleRow(pB + i * columns, 1.0 / m_matrix(i, i), columns);
+            }
+            next = first;
+        }
+    }
+};
+
+#endif /* MATRIXFACTORIZATION_H_ */
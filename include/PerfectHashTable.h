@@ -0,0 +1,311 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for PerfectHashTable.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef PERFECTHASHTABLE_H_
+#define PERFECTHASHTABLE_H_
+
+#include "StringRef.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+/* Minimal perfect hash tables for string keys known at compile time:
+ *
+ *     static constexpr auto grades = makePerfectHashTable<int>({
+ *         {"A", 4}, {"B", 3}, {"C", 2}, {"D", 1}, {"F", 0}
+ *     });
+ *
+ * The table is built by the compiler ("hash and displace"): the keys are
+ * distributed over N buckets, then bucket by bucket (largest first) a
+ * displacement is searched which moves all keys of the bucket to free slots.
+ * The result are N slots plus N displacements in static storage, so there is
+ * no allocation and no initialization at startup. A lookup is two hashes and
+ * one key compare.
+ *
+ * Everything is C++11 constexpr, i.e. recursion instead of loops. The free
+ * slots are tracked in one 64 bit mask, so a table holds at most 64 keys.
+ */
+
+template <typename Value>
+struct CStaticEntry {
+    const char * m_pKey;
+    Value m_value;
+};
+
+/* constexpr string hashing, also used at runtime so both agree */
+struct CConstexprHash {
+    static constexpr std::size_t length(const char * pKey) {
+        return *pKey ? 1 + length(pKey + 1) : 0;
+    }
+
+    static constexpr bool equal(const char * pLhs, const char * pRhs) {
+        return *pLhs == *pRhs && (*pLhs == 0 || equal(pLhs + 1, pRhs + 1));
+    }
+
+    static constexpr std::uint32_t fnv(const char * pKey, std::size_t size, std::uint32_t hash) {
+        return size == 0 ? hash : fnv(pKey + 1, size - 1, (hash ^ static_cast<unsigned char>(*pKey)) * 16777619u);
+    }
+
+    static constexpr std::uint32_t shiftXor(std::uint32_t hash, unsigned int shift) {
+        return hash ^ (hash >> shift);
+    }
+
+    // murmur3 finalizer, so every seed gives a well spread hash
+    static constexpr std::uint32_t hash(const char * pKey, std::size_t size, std::uint32_t seed) {
+        return shiftXor(shiftXor(shiftXor(fnv(pKey, size, 2166136261u ^ (seed * 0x9E3779B9u)), 16) * 0x85ebca6bu, 13) * 0xc2b2ae35u, 16);
+    }
+
+    // maps a hash onto [0, n) without division
+    static constexpr std::size_t reduce(std::uint32_t hash, std::size_t n) {
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(hash) * n) >> 32);
+    }
+};
+
+/* C++11 has no std::index_sequence */
+template <std::size_t... I>
+struct CIndexSequence {};
+
+template <std::size_t N, std::size_t... I>
+struct CMakeIndexSequence : CMakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <std::size_t... I>
+struct CMakeIndexSequence<0, I...> : CIndexSequence<I...> {};
+
+
+template <typename Value, std::size_t N>
+class CPerfectHashTable {
+public:
+    static_assert(N > 0 && N <= 64, "CPerfectHashTable holds 1 to 64 keys");
+
+    typedef CStaticEntry<Value> Entry;
+
+    constexpr explicit CPerfectHashTable(const Entry (&entries)[N]) :
+        CPerfectHashTable(entries, build(entries, CMakeIndexSequence<N>()), CMakeIndexSequence<N>()) {}
+
+    static constexpr std::size_t size() {
+        return N;
+    }
+
+    // nullptr if the key is not in the table
+    const Value * find(CStringRef key) const {
+        const CSlot & slot = m_slots[slotOf(key.data(), key.size(), m_displacements)];
+        return slot.m_size == key.size() && std::memcmp(slot.m_pKey, key.data(), key.size()) == 0 ? &slot.m_value : nullptr;
+    }
+
+    // usable at compile time as well
+    constexpr const Value & at(const char * pKey) const {
+        return CConstexprHash::equal(m_slots[slotOf(pKey, CConstexprHash::length(pKey), m_displacements)].m_pKey, pKey)
+                ? m_slots[slotOf(pKey, CConstexprHash::length(pKey), m_displacements)].m_value
+                : throw std::out_of_range("CPerfectHashTable::at: key not found");
+    }
+
+    // key stored in the given slot, mainly for iterating and testing
+    constexpr const char * keyAt(std::size_t slot) const {
+        return m_slots[slot].m_pKey;
+    }
+
+private:
+    static const std::uint32_t NOT_FOUND = 0xffffffffu;
+    static const std::uint32_t MAX_DISPLACEMENT = 1u << 16;
+
+    struct CSlot {
+        const char * m_pKey;
+        std::size_t m_size;
+        Value m_value;
+    };
+
+    static constexpr CSlot makeSlot(const Entry & entry) {
+        return CSlot{ entry.m_pKey, CConstexprHash::length(entry.m_pKey), entry.m_value };
+    }
+
+    static constexpr std::size_t bucketOf(const char * pKey, std::size_t size) {
+        return CConstexprHash::reduce(CConstexprHash::hash(pKey, size, 0), N);
+    }
+
+    static constexpr std::size_t slotOf(const char * pKey, std::size_t size, std::uint32_t displacement) {
+        return CConstexprHash::reduce(CConstexprHash::hash(pKey, size, displacement + 1), N);
+    }
+
+    static constexpr std::size_t slotOf(const char * pKey, std::size_t size, const std::uint32_t (&displacements)[N]) {
+        return slotOf(pKey, size, displacements[bucketOf(pKey, size)]);
+    }
+
+    /* --- building, all evaluated by the compiler ---
+     * Every step computes one array (one element per key, bucket or slot) by
+     * pack expansion and hands it to the next step as argument, so nothing
+     * is computed twice.
+     */
+
+    struct CKeys {
+        const char * m_pKeys[N];
+        std::size_t m_sizes[N];
+        std::size_t m_buckets[N];
+    };
+
+    struct CIndices {
+        std::size_t m_values[N];
+    };
+
+    // displacements per bucket of the buckets placed so far and the slots they use
+    struct CPlacement {
+        std::uint32_t m_displacements[N];
+        std::uint64_t m_occupied;
+    };
+
+    struct CLayout {
+        std::size_t m_entryInSlot[N];
+        std::uint32_t m_displacements[N];
+    };
+
+    // slots used by one bucket, ok is false if its keys collide
+    struct CFit {
+        bool m_bOk;
+        std::uint64_t m_mask;
+    };
+
+    template <std::size_t... I>
+    constexpr CPerfectHashTable(const Entry (&entries)[N], const CLayout & layout, CIndexSequence<I...>) :
+        m_slots{ makeSlot(entries[layout.m_entryInSlot[I]])... },
+        m_displacements{ layout.m_displacements[I]... } {}
+
+    template <std::size_t... I>
+    static constexpr CLayout build(const Entry (&entries)[N], CIndexSequence<I...> indices) {
+        return layout(keys(entries, indices), indices);
+    }
+
+    template <std::size_t... I>
+    static constexpr CKeys keys(const Entry (&entries)[N], CIndexSequence<I...>) {
+        return CKeys{
+            { entries[I].m_pKey... },
+            { CConstexprHash::length(entries[I].m_pKey)... },
+            { bucketOf(entries[I].m_pKey, CConstexprHash::length(entries[I].m_pKey))... } };
+    }
+
+    template <std::size_t... I>
+    static constexpr CLayout layout(const CKeys & keys, CIndexSequence<I...> indices) {
+        return layout(keys, placement(keys, order(ranks(bucketSizes(keys, indices), indices), indices),
+                CPlacement{ {}, 0 }, std::integral_constant<std::size_t, N>()), indices);
+    }
+
+    template <std::size_t... I>
+    static constexpr CLayout layout(const CKeys & keys, const CPlacement & placement, CIndexSequence<I...> indices) {
+        return layoutFromSlots(placement, finalSlots(keys, placement, indices), indices);
+    }
+
+    template <std::size_t... I>
+    static constexpr CLayout layoutFromSlots(const CPlacement & placement, const CIndices & slots, CIndexSequence<I...>) {
+        return CLayout{ { find(slots, I, 0)... }, { placement.m_displacements[I]... } };
+    }
+
+    // index of the first element equal to value
+    static constexpr std::size_t find(const CIndices & indices, std::size_t value, std::size_t position) {
+        return indices.m_values[position] == value ? position : find(indices, value, position + 1);
+    }
+
+    static constexpr std::size_t count(const std::size_t (&values)[N], std::size_t value, std::size_t position) {
+        return position == N ? 0 : (values[position] == value) + count(values, value, position + 1);
+    }
+
+    template <std::size_t... I>
+    static constexpr CIndices bucketSizes(const CKeys & keys, CIndexSequence<I...>) {
+        return CIndices{ { count(keys.m_buckets, I, 0)... } };
+    }
+
+    // buckets are placed by decreasing size, then by index
+    static constexpr std::size_t rank(const CIndices & sizes, std::size_t bucket, std::size_t other) {
+        return other == N ? 0
+                : (sizes.m_values[other] > sizes.m_values[bucket] || (sizes.m_values[other] == sizes.m_values[bucket] && other < bucket))
+                    + rank(sizes, bucket, other + 1);
+    }
+
+    template <std::size_t... I>
+    static constexpr CIndices ranks(const CIndices & sizes, CIndexSequence<I...>) {
+        return CIndices{ { rank(sizes, I, 0)... } };
+    }
+
+    // bucket placed at each rank
+    template <std::size_t... I>
+    static constexpr CIndices order(const CIndices & ranks, CIndexSequence<I...>) {
+        return CIndices{ { find(ranks, I, 0)... } };
+    }
+
+    static constexpr CFit addSlot(CFit fit, std::size_t slot) {
+        return CFit{ fit.m_bOk && !(fit.m_mask & (std::uint64_t(1) << slot)), fit.m_mask | (std::uint64_t(1) << slot) };
+    }
+
+    // adds the slots of all keys of bucket (from key on) under displacement to occupied
+    static constexpr CFit fit(const CKeys & keys, std::size_t bucket, std::uint32_t displacement, CFit occupied, std::size_t key) {
+        return key == N || !occupied.m_bOk ? occupied
+                : fit(keys, bucket, displacement,
+                        keys.m_buckets[key] != bucket ? occupied
+                        : addSlot(occupied, slotOf(keys.m_pKeys[key], keys.m_sizes[key], displacement)),
+                        key + 1);
+    }
+
+    static constexpr std::uint32_t orNext(std::uint32_t found, const CKeys & keys, std::size_t bucket, std::uint64_t occupied, std::uint32_t first, std::uint32_t last) {
+        return found != NOT_FOUND ? found : firstFit(keys, bucket, occupied, first, last);
+    }
+
+    // smallest displacement in [first, last) which fits, split in halves to keep the recursion shallow
+    static constexpr std::uint32_t firstFit(const CKeys & keys, std::size_t bucket, std::uint64_t occupied, std::uint32_t first, std::uint32_t last) {
+        return last - first == 1
+                ? (fit(keys, bucket, first, CFit{ true, occupied }, 0).m_bOk ? first : NOT_FOUND)
+                : orNext(firstFit(keys, bucket, occupied, first, first + (last - first) / 2),
+                        keys, bucket, occupied, first + (last - first) / 2, last);
+    }
+
+    static constexpr std::uint32_t checked(std::uint32_t displacement) {
+        return displacement != NOT_FOUND ? displacement
+                : throw std::logic_error("CPerfectHashTable: no displacement found, duplicate keys?");
+    }
+
+    template <std::size_t... I>
+    static constexpr CPlacement place(const CKeys & keys, const CPlacement & placed, std::size_t bucket, std::uint32_t displacement, CIndexSequence<I...>) {
+        return CPlacement{
+            { (I == bucket ? displacement : placed.m_displacements[I])... },
+            fit(keys, bucket, displacement, CFit{ true, placed.m_occupied }, 0).m_mask };
+    }
+
+    // places the first Remaining buckets of order, one template instance per step
+    template <std::size_t Remaining>
+    static constexpr CPlacement placement(const CKeys & keys, const CIndices & order, const CPlacement & placed, std::integral_constant<std::size_t, Remaining>) {
+        return placement(keys, order,
+                place(keys, placed, order.m_values[N - Remaining],
+                        checked(firstFit(keys, order.m_values[N - Remaining], placed.m_occupied, 0, MAX_DISPLACEMENT)),
+                        CMakeIndexSequence<N>()),
+                std::integral_constant<std::size_t, Remaining - 1>());
+    }
+
+    static constexpr CPlacement placement(const CKeys &, const CIndices &, const CPlacement & placed, std::integral_constant<std::size_t, 0>) {
+        return placed;
+    }
+
+    template <std::size_t... I>
+    static constexpr CIndices finalSlots(const CKeys & keys, const CPlacement & placement, CIndexSequence<I...>) {
+        return CIndices{ { slotOf(keys.m_pKeys[I], keys.m_sizes[I], placement.m_displacements[keys.m_buckets[I]])... } };
+    }
+
+    CSlot m_slots[N];
+    std::uint32_t m_displacements[N];
+};
+
+template <typename Value, std::size_t N>
+constexpr CPerfectHashTable<Value, N> makePerfectHashTable(const CStaticEntry<Value> (&entries)[N]) {
+    return CPerfectHashTable<Value, N>(entries);
+}
+
+#endif /* PERFECTHASHTABLE_H_ */
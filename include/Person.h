@@ -0,0 +1,29 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for Person.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef PERSON_H_
+#define PERSON_H_
+
+/* member functions are defined in AutoAndDecltype.cpp */
+class Person
+{
+public:
+    enum PersonType { ADULT, CHILD, SENIOR };
+    void setPersonType (PersonType person_type);
+    PersonType getPersonType ();
+private:
+    PersonType _person_type;
+};
+
+#endif /* PERSON_H_ */
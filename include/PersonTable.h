@@ -0,0 +1,249 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for PersonTable.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef PERSONTABLE_H_
+#define PERSONTABLE_H_
+
+#include "BlockThreads.h"
+#include "Person.h"
+#include "StringPool.h"
+#include "StringRef.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/* Column store for many Person records: one vector per column, all indexed
+ * by record, so a scan of one column never loads the others.
+ *
+ * The person type column packs 2 bits per record into 64 bit words (32
+ * records per word, 16x less memory than one enum per record). Counting and
+ * filtering work on whole words: the two bit planes of a word are split with
+ * masks, matches are counted with popcount and iterated with count trailing
+ * zeros. Large tables are processed in chunks of whole words, in parallel
+ * on the CBlockThreads (BlockThreads.h); a table of one chunk stays on the
+ * calling thread.
+ *
+ * The name column holds a CStringPool id per record (4 bytes), each
+ * distinct name is stored once. Id 0 is the empty name of new records.
+ */
+class CPersonTable {
+public:
+    typedef Person::PersonType PersonType;
+    typedef std::array<std::size_t, 3> Histogram; // indexed by PersonType
+
+    static const std::size_t RECORDS_PER_WORD = 32;
+
+    explicit CPersonTable(std::size_t size = 0, PersonType type = Person::ADULT) :
+        m_size(size),
+        m_vecTypes(wordCount(size), pattern(type) ),
+        m_vecNameIds(size, m_names.intern(CStringRef())) {
+        clearTail();
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    // bytes used by the packed person type column
+    std::size_t typeColumnBytes() const {
+        return m_vecTypes.size() * sizeof(std::uint64_t);
+    }
+
+    void push_back(PersonType type, CStringRef name = CStringRef()) {
+        m_vecNameIds.push_back(m_names.intern(name));
+        if ( m_size % RECORDS_PER_WORD == 0 ) {
+            m_vecTypes.push_back(0);
+        }
+        ++m_size;
+        setPersonType(m_size - 1, type);
+    }
+
+    // valid as long as the table exists
+    CStringRef getName(std::size_t index) const {
+        checkIndex(index);
+        return m_names.str(m_vecNameIds[index]);
+    }
+
+    void setName(std::size_t index, CStringRef name) {
+        checkIndex(index);
+        m_vecNameIds[index] = m_names.intern(name);
+    }
+
+    PersonType getPersonType(std::size_t index) const {
+        checkIndex(index);
+        return static_cast<PersonType>((m_vecTypes[index / RECORDS_PER_WORD] >> shift(index)) & 3u);
+    }
+
+    void setPersonType(std::size_t index, PersonType type) {
+        checkIndex(index);
+        std::uint64_t & word = m_vecTypes[index / RECORDS_PER_WORD];
+        word = (word & ~(std::uint64_t(3) << shift(index))) | (std::uint64_t(type) << shift(index));
+    }
+
+    // bulk set for the records [first, last)
+    void setPersonType(std::size_t first, std::size_t last, PersonType type) {
+        if ( first > last || last > m_size ) {
+            throw std::out_of_range("CPersonTable::setPersonType: invalid range");
+        }
+        if ( first == last ) {
+            return;
+        }
+        const std::uint64_t fill = pattern(type);
+        std::size_t firstWord = first / RECORDS_PER_WORD;
+        std::size_t lastWord = last / RECORDS_PER_WORD;
+        if ( firstWord == lastWord ) {
+            setBits(firstWord, rangeMask(first, last), fill);
+            return;
+        }
+        setBits(firstWord, rangeMask(first, (firstWord + 1) * RECORDS_PER_WORD), fill);
+        if ( last % RECORDS_PER_WORD ) {
+            setBits(lastWord, rangeMask(lastWord * RECORDS_PER_WORD, last), fill);
+        }
+        forEachChunk(firstWord + 1, lastWord, [this, fill] (std::size_t, std::size_t begin, std::size_t end) {
+            std::fill(m_vecTypes.begin() + begin, m_vecTypes.begin() + end, fill);
+        } );
+    }
+
+    // how many records of each type
+    Histogram countByType() const {
+        std::vector<Histogram> vecPartial(chunkCount(m_vecTypes.size()), Histogram());
+        forEachChunk(0, m_vecTypes.size(), [this, &vecPartial] (std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::size_t children = 0;
+            std::size_t seniors = 0;
+            for ( std::size_t i = begin; i < end; ++i ) {
+                const std::uint64_t low = m_vecTypes[i] & LOW_BITS;
+                const std::uint64_t high = (m_vecTypes[i] >> 1) & LOW_BITS;
+                children += __builtin_popcountll(low & ~high);
+                seniors += __builtin_popcountll(high & ~low);
+            }
+            vecPartial[chunk][Person::CHILD] = children;
+            vecPartial[chunk][Person::SENIOR] = seniors;
+        } );
+
+        Histogram result = Histogram();
+        for ( auto& partial : vecPartial ) {
+            result[Person::CHILD] += partial[Person::CHILD];
+            result[Person::SENIOR] += partial[Person::SENIOR];
+        }
+        // the unused tail of the last word is zero, i.e. never counts as child or senior
+        result[Person::ADULT] = m_size - result[Person::CHILD] - result[Person::SENIOR];
+        return result;
+    }
+
+    // ascending indices of all records of the given type
+    std::vector<std::size_t> indicesOf(PersonType type) const {
+        std::vector<std::vector<std::size_t>> vecPartial(chunkCount(m_vecTypes.size()));
+        forEachChunk(0, m_vecTypes.size(), [this, type, &vecPartial] (std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::vector<std::size_t> & vecIndices = vecPartial[chunk];
+            for ( std::size_t i = begin; i < end; ++i ) {
+                std::uint64_t matches = matchMask(i, type);
+                while ( matches ) {
+                    vecIndices.push_back(i * RECORDS_PER_WORD + __builtin_ctzll(matches) / 2);
+                    matches &= matches - 1;
+                }
+            }
+        } );
+
+        if ( vecPartial.size() == 1 ) {
+            return std::move(vecPartial[0]);
+        }
+        std::size_t total = 0;
+        for ( auto& vecIndices : vecPartial ) {
+            total += vecIndices.size();
+        }
+        std::vector<std::size_t> vecResult;
+        vecResult.reserve(total);
+        for ( auto& vecIndices : vecPartial ) {
+            vecResult.insert(vecResult.end(), vecIndices.begin(), vecIndices.end());
+        }
+        return vecResult;
+    }
+
+private:
+    static const std::uint64_t LOW_BITS = 0x5555555555555555ull;
+    // 256 KB, enough work to be worth handing to another thread
+    static const std::size_t WORDS_PER_CHUNK = 1 << 15;
+
+    static std::size_t wordCount(std::size_t records) {
+        return (records + RECORDS_PER_WORD - 1) / RECORDS_PER_WORD;
+    }
+
+    static unsigned int shift(std::size_t index) {
+        return 2 * (index % RECORDS_PER_WORD);
+    }
+
+    static std::uint64_t pattern(PersonType type) {
+        return LOW_BITS * type;
+    }
+
+    // both bits of every record in [first, last), which lie in the same word
+    static std::uint64_t rangeMask(std::size_t first, std::size_t last) {
+        std::size_t count = last - first;
+        std::uint64_t mask = count == RECORDS_PER_WORD ? ~std::uint64_t(0) : (std::uint64_t(1) << (2 * count)) - 1;
+        return mask << shift(first);
+    }
+
+    static std::size_t chunkCount(std::size_t words) {
+        return std::max<std::size_t>(1, (words + WORDS_PER_CHUNK - 1) / WORDS_PER_CHUNK);
+    }
+
+    // calls func(chunk, begin, end) for the chunkCount() word ranges of [first, last)
+    template <typename Func>
+    static void forEachChunk(std::size_t first, std::size_t last, Func func) {
+        if ( first >= last ) {
+            return;
+        }
+        parallelBlocks(chunkCount(last - first), [first, last, &func] (std::size_t chunk) {
+            const std::size_t begin = first + chunk * WORDS_PER_CHUNK;
+            func(chunk, begin, std::min(begin + WORDS_PER_CHUNK, last));
+        } );
+    }
+
+    // one bit (the low one of the pair) per record of the given type
+    std::uint64_t matchMask(std::size_t word, PersonType type) const {
+        const std::uint64_t diff = m_vecTypes[word] ^ pattern(type);
+        std::uint64_t matches = ~(diff | (diff >> 1)) & LOW_BITS;
+        if ( word == m_vecTypes.size() - 1 && m_size % RECORDS_PER_WORD ) {
+            matches &= rangeMask(word * RECORDS_PER_WORD, m_size);
+        }
+        return matches;
+    }
+
+    void setBits(std::size_t word, std::uint64_t mask, std::uint64_t fill) {
+        m_vecTypes[word] = (m_vecTypes[word] & ~mask) | (fill & mask);
+    }
+
+    void clearTail() {
+        if ( m_size % RECORDS_PER_WORD ) {
+            m_vecTypes.back() &= rangeMask(m_size - m_size % RECORDS_PER_WORD, m_size);
+        }
+    }
+
+    void checkIndex(std::size_t index) const {
+        if ( index >= m_size ) {
+            throw std::out_of_range("CPersonTable: index out of range");
+        }
+    }
+
+    std::size_t m_size;
+    std::vector<std::uint64_t> m_vecTypes;
+    CStringPool m_names;  // before m_vecNameIds, which is initialized with an id of it
+    std::vector<CStringPool::Id> m_vecNameIds;
+};
+
+#endif /* PERSONTABLE_H_ */
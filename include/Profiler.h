@@ -0,0 +1,539 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for Profiler.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Profiling of hot paths in running programs, without a profiler attached:
+ *
+ *     PROFILE_SCOPE("CMatrix::operator*");         // latency of the scope
+ *     PROFILE_COUNT("CIsbnService::isbns", n);     // adds n to a counter
+ *
+ *     CProfiler::instance().setEnabled(true);
+ *     ...
+ *     CProfiler::instance().snapshot().writeJson(std::cout);
+ *
+ * Every thread records into its own histograms and counters (single writer,
+ * no lock, no atomic read-modify-write); snapshot() merges them. When
+ * profiling is off a scope costs one relaxed load and a branch.
+ */
+
+/* time stamps for the scopes: the time stamp counter where there is one
+ * (a few ns to read), std::chrono::steady_clock elsewhere */
+class CProfileClock {
+public:
+    typedef std::uint64_t Ticks;
+
+    static Ticks now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<Ticks>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+};
+
+
+/* HDR style histogram: 16 linear sub buckets per power of two, i.e. every
+ * value is known to about 6 %, over the whole range of std::uint64_t.
+ * Values below 16 get a bucket of their own.
+ */
+class CLogHistogram {
+public:
+    static const unsigned int SUB_BITS = 4;
+    static const std::size_t SUB_BUCKETS = std::size_t(1) << SUB_BITS;
+    static const std::size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    CLogHistogram() : m_vecBuckets(BUCKETS, 0), m_count(0), m_sum(0), m_max(0) {}
+
+    static std::size_t bucketOf(std::uint64_t value) {
+        if ( value < SUB_BUCKETS ) {
+            return static_cast<std::size_t>(value);
+        }
+        const unsigned int shift = 63 - __builtin_clzll(value) - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + static_cast<std::size_t>((value >> shift) - SUB_BUCKETS);
+    }
+
+    static std::uint64_t lowerBound(std::size_t bucket) {
+        const std::size_t block = bucket >> SUB_BITS;
+        const std::uint64_t sub = bucket & (SUB_BUCKETS - 1);
+        return block == 0 ? sub : (SUB_BUCKETS + sub) << (block - 1);
+    }
+
+    static std::uint64_t upperBound(std::size_t bucket) {
+        return bucket + 1 < BUCKETS ? lowerBound(bucket + 1) - 1 : ~std::uint64_t(0);
+    }
+
+    void add(std::uint64_t value, std::uint64_t count = 1) {
+        addBucket(bucketOf(value), count);
+        m_sum += value * count;
+        if ( value > m_max ) {
+            m_max = value;
+        }
+    }
+
+    // count values in the bucket, for merging; sum and max must be added separately
+    void addBucket(std::size_t bucket, std::uint64_t count) {
+        m_vecBuckets[bucket] += count;
+        m_count += count;
+    }
+
+    void addSummary(std::uint64_t sum, std::uint64_t max) {
+        m_sum += sum;
+        if ( max > m_max ) {
+            m_max = max;
+        }
+    }
+
+    void merge(const CLogHistogram & other) {
+        for ( std::size_t i = 0; i < BUCKETS; ++i ) {
+            m_vecBuckets[i] += other.m_vecBuckets[i];
+        }
+        m_count += other.m_count;
+        addSummary(other.m_sum, other.m_max);
+    }
+
+    std::uint64_t count() const { return m_count; }
+    std::uint64_t sum() const { return m_sum; }
+    std::uint64_t max() const { return m_max; }
+    std::uint64_t bucketCount(std::size_t bucket) const { return m_vecBuckets[bucket]; }
+
+    double mean() const {
+        return m_count ? static_cast<double>(m_sum) / m_count : 0.0;
+    }
+
+    /* highest value of the bucket holding the nearest rank percentile, i.e.
+     * never below the exact percentile and at most one bucket width above */
+    std::uint64_t percentile(double percent) const {
+        if ( m_count == 0 ) {
+            return 0;
+        }
+        std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(percent / 100.0 * m_count));
+        rank = rank < 1 ? 1 : (rank > m_count ? m_count : rank);
+        std::uint64_t seen = 0;
+        for ( std::size_t i = 0; i < BUCKETS; ++i ) {
+            seen += m_vecBuckets[i];
+            if ( seen >= rank ) {
+                std::uint64_t upper = upperBound(i);
+                return upper < m_max ? upper : m_max;
+            }
+        }
+        return m_max;
+    }
+
+private:
+    std::vector<std::uint64_t> m_vecBuckets;
+    std::uint64_t m_count;
+    std::uint64_t m_sum;
+    std::uint64_t m_max;
+};
+
+
+/* merged state of all threads; latencies are kept in clock ticks and
+ * converted to nanoseconds on the way out */
+class CProfileSnapshot {
+public:
+    struct CProbe {
+        std::string m_strName;
+        CLogHistogram m_latency;  // ticks of CProfileClock
+        std::uint64_t m_counter;
+    };
+
+    CProfileSnapshot(std::vector<CProbe> vecProbes, double nsPerTick, bool bEnabled) :
+        m_vecProbes(std::move(vecProbes)), m_nsPerTick(nsPerTick), m_bEnabled(bEnabled) {}
+
+    const std::vector<CProbe> & probes() const {
+        return m_vecProbes;
+    }
+
+    // nullptr if there is no such probe
+    const CProbe * find(const std::string & strName) const {
+        for ( auto& probe : m_vecProbes ) {
+            if ( probe.m_strName == strName ) {
+                return &probe;
+            }
+        }
+        return nullptr;
+    }
+
+    double nanoseconds(std::uint64_t ticks) const {
+        return ticks * m_nsPerTick;
+    }
+
+    double percentileNs(const CProbe & probe, double percent) const {
+        return nanoseconds(probe.m_latency.percentile(percent));
+    }
+
+    /* {"enabled":true,"ns_per_tick":0.33,"probes":[{"name":"...","count":3,
+     *   "counter":0,"mean_ns":..,"max_ns":..,"p50_ns":..,"p90_ns":..,"p99_ns":..,
+     *   "p999_ns":..,"buckets":[[upper_ns,count],...]},...]}
+     * buckets lists the non empty buckets only */
+    void writeJson(std::ostream & out) const {
+        std::ostringstream json;
+        json << std::setprecision(6);
+        json << "{\"enabled\":" << (m_bEnabled ? "true" : "false")
+             << ",\"ns_per_tick\":" << m_nsPerTick << ",\"probes\":[";
+        for ( std::size_t i = 0; i < m_vecProbes.size(); ++i ) {
+            const CProbe & probe = m_vecProbes[i];
+            const CLogHistogram & latency = probe.m_latency;
+            json << (i ? "," : "") << "{\"name\":";
+            writeJsonString(json, probe.m_strName);
+            json << ",\"count\":" << latency.count()
+                 << ",\"counter\":" << probe.m_counter
+                 << ",\"mean_ns\":" << latency.mean() * m_nsPerTick
+                 << ",\"max_ns\":" << nanoseconds(latency.max())
+                 << ",\"p50_ns\":" << percentileNs(probe, 50)
+                 << ",\"p90_ns\":" << percentileNs(probe, 90)
+                 << ",\"p99_ns\":" << percentileNs(probe, 99)
+                 << ",\"p999_ns\":" << percentileNs(probe, 99.9)
+                 << ",\"buckets\":[";
+            bool bFirst = true;
+            for ( std::size_t bucket = 0; bucket < CLogHistogram::BUCKETS; ++bucket ) {
+                if ( latency.bucketCount(bucket) ) {
+                    json << (bFirst ? "" : ",") << "[" << nanoseconds(CLogHistogram::upperBound(bucket))
+                         << "," << latency.bucketCount(bucket) << "]";
+                    bFirst = false;
+                }
+            }
+            json << "]}";
+        }
+        json << "]}";
+        out << json.str();
+    }
+
+    std::string json() const {
+        std::ostringstream out;
+        writeJson(out);
+        return out.str();
+    }
+
+private:
+    static void writeJsonString(std::ostream & out, const std::string & str) {
+        out << '"';
+        for ( char c : str ) {
+            if ( c == '"' || c == '\\' ) {
+                out << '\\' << c;
+            }
+            else if ( static_cast<unsigned char>(c) < 0x20 ) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+                    << std::dec << std::setfill(' ');
+            }
+            else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    std::vector<CProbe> m_vecProbes;
+    double m_nsPerTick;
+    bool m_bEnabled;
+};
+
+
+class CProfiler {
+public:
+    static const std::size_t MAX_PROBES = 64;
+
+    static CProfiler & instance() {
+        static CProfiler profiler;
+        return profiler;
+    }
+
+    // constant initialised, so checking it needs no guard
+    static bool enabled() {
+        return enabledFlag().load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool bEnabled) {
+        enabledFlag().store(bEnabled, std::memory_order_relaxed);
+    }
+
+    // id of the probe with this name, registered on first use
+    std::size_t probe(const std::string & strName) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for ( std::size_t i = 0; i < m_vecNames.size(); ++i ) {
+            if ( m_vecNames[i] == strName ) {
+                return i;
+            }
+        }
+        if ( m_vecNames.size() == MAX_PROBES ) {
+            throw std::length_error("CProfiler::probe: too many probes");
+        }
+        m_vecNames.push_back(strName);
+        return m_vecNames.size() - 1;
+    }
+
+    void record(std::size_t probe, CProfileClock::Ticks ticks) {
+        threadProfile().histogram(probe).add(ticks);
+    }
+
+    void count(std::size_t probe, std::uint64_t n) {
+        bump(threadProfile().m_counters[probe], n);
+    }
+
+    CProfileSnapshot snapshot() const {
+        std::vector<CProfileSnapshot::CProbe> vecProbes;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            vecProbes.resize(m_vecNames.size());
+            for ( std::size_t i = 0; i < vecProbes.size(); ++i ) {
+                vecProbes[i].m_strName = m_vecNames[i];
+                if ( i < m_vecExited.size() ) {
+                    vecProbes[i].m_latency = m_vecExited[i].m_latency;
+                    vecProbes[i].m_counter = m_vecExited[i].m_counter;
+                }
+            }
+            for ( auto pProfile : m_vecThreads ) {
+                pProfile->mergeInto(vecProbes);
+            }
+        }
+        return CProfileSnapshot(std::move(vecProbes), nsPerTick(), enabled());
+    }
+
+    /* forgets everything recorded so far; only exact while no other thread
+     * records at the same time */
+    void reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_vecExited.clear();
+        for ( auto pProfile : m_vecThreads ) {
+            pProfile->clear();
+        }
+    }
+
+private:
+    // only the owning thread writes, so a load and a store do instead of fetch_add
+    static void bump(std::atomic<std::uint64_t> & value, std::uint64_t n) {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    struct CThreadHistogram {
+        CThreadHistogram() : m_sum(0), m_max(0) {
+            for ( auto& bucket : m_buckets ) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        void add(CProfileClock::Ticks ticks) {
+            bump(m_buckets[CLogHistogram::bucketOf(ticks)], 1);
+            bump(m_sum, ticks);
+            if ( ticks > m_max.load(std::memory_order_relaxed) ) {
+                m_max.store(ticks, std::memory_order_relaxed);
+            }
+        }
+
+        void mergeInto(CLogHistogram & histogram) const {
+            for ( std::size_t i = 0; i < CLogHistogram::BUCKETS; ++i ) {
+                std::uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+                if ( count ) {
+                    histogram.addBucket(i, count);
+                }
+            }
+            histogram.addSummary(m_sum.load(std::memory_order_relaxed), m_max.load(std::memory_order_relaxed));
+        }
+
+        std::atomic<std::uint64_t> m_buckets[CLogHistogram::BUCKETS];
+        std::atomic<std::uint64_t> m_sum;
+        std::atomic<std::uint64_t> m_max;
+    };
+
+    // histograms are allocated on the first record of a probe, by the owning thread
+    struct CThreadProfile {
+        CThreadProfile() {
+            for ( std::size_t i = 0; i < MAX_PROBES; ++i ) {
+                m_pHistograms[i].store(nullptr, std::memory_order_relaxed);
+                m_counters[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        ~CThreadProfile() {
+            for ( auto& pHistogram : m_pHistograms ) {
+                delete pHistogram.load(std::memory_order_relaxed);
+            }
+        }
+
+        CThreadHistogram & histogram(std::size_t probe) {
+            CThreadHistogram * pHistogram = m_pHistograms[probe].load(std::memory_order_relaxed);
+            if ( !pHistogram ) {
+                pHistogram = new CThreadHistogram();
+                m_pHistograms[probe].store(pHistogram, std::memory_order_release);
+            }
+            return *pHistogram;
+        }
+
+        void mergeInto(std::vector<CProfileSnapshot::CProbe> & vecProbes) const {
+            for ( std::size_t i = 0; i < vecProbes.size(); ++i ) {
+                const CThreadHistogram * pHistogram = m_pHistograms[i].load(std::memory_order_acquire);
+                if ( pHistogram ) {
+                    pHistogram->mergeInto(vecProbes[i].m_latency);
+                }
+                vecProbes[i].m_counter += m_counters[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        void clear() {
+            for ( std::size_t i = 0; i < MAX_PROBES; ++i ) {
+                CThreadHistogram * pHistogram = m_pHistograms[i].load(std::memory_order_acquire);
+                if ( pHistogram ) {
+                    for ( auto& bucket : pHistogram->m_buckets ) {
+                        bucket.store(0, std::memory_order_relaxed);
+                    }
+                    pHistogram->m_sum.store(0, std::memory_order_relaxed);
+                    pHistogram->m_max.store(0, std::memory_order_relaxed);
+                }
+                m_counters[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<CThreadHistogram *> m_pHistograms[MAX_PROBES];
+        std::atomic<std::uint64_t> m_counters[MAX_PROBES];
+    };
+
+    // merges the profile of the thread into m_vecExited when the thread exits
+    struct CThreadProfileOwner {
+        CThreadProfile * m_pProfile;
+
+        ~CThreadProfileOwner() {
+            if ( m_pProfile ) {
+                CProfiler::instance().retire(m_pProfile);
+            }
+        }
+    };
+
+    CProfiler() :
+        m_startTicks(CProfileClock::now()),
+        m_startTime(std::chrono::steady_clock::now()) {}
+
+    CProfiler(const CProfiler &) = delete;
+    CProfiler & operator=(const CProfiler &) = delete;
+
+    static std::atomic<bool> & enabledFlag() {
+        static std::atomic<bool> bEnabled(false);
+        return bEnabled;
+    }
+
+    static CThreadProfileOwner & threadProfileOwner() {
+        static thread_local CThreadProfileOwner owner{nullptr};
+        return owner;
+    }
+
+    CThreadProfile & threadProfile() {
+        CThreadProfileOwner & owner = threadProfileOwner();
+        if ( !owner.m_pProfile ) {
+            owner.m_pProfile = new CThreadProfile();
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_vecThreads.push_back(owner.m_pProfile);
+        }
+        return *owner.m_pProfile;
+    }
+
+    void retire(CThreadProfile * pProfile) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if ( m_vecExited.size() < m_vecNames.size() ) {
+            m_vecExited.resize(m_vecNames.size());
+        }
+        pProfile->mergeInto(m_vecExited);
+        for ( auto itr = m_vecThreads.begin(); itr != m_vecThreads.end(); ++itr ) {
+            if ( *itr == pProfile ) {
+                m_vecThreads.erase(itr);
+                break;
+            }
+        }
+        delete pProfile;
+    }
+
+    /* the time stamp counter is calibrated against std::chrono::steady_clock
+     * since construction, over at least 10 ms */
+    double nsPerTick() const {
+#if defined(__x86_64__) || defined(__i386__)
+        const auto minimum = std::chrono::milliseconds(10);
+        auto elapsed = std::chrono::steady_clock::now() - m_startTime;
+        if ( elapsed < minimum ) {
+            std::this_thread::sleep_for(minimum - elapsed);
+        }
+        const CProfileClock::Ticks ticks = CProfileClock::now() - m_startTicks;
+        elapsed = std::chrono::steady_clock::now() - m_startTime;
+        return std::chrono::duration<double, std::nano>(elapsed).count() / ticks;
+#else
+        return 1.0;
+#endif
+    }
+
+    const CProfileClock::Ticks m_startTicks;
+    const std::chrono::steady_clock::time_point m_startTime;
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_vecNames;
+    std::vector<CThreadProfile *> m_vecThreads;
+    std::vector<CProfileSnapshot::CProbe> m_vecExited;  // what exited threads recorded
+};
+
+
+/* records the time from construction to destruction, if profiling is on */
+class CProfileScope {
+public:
+    explicit CProfileScope(std::size_t probe) :
+        m_probe(probe),
+        m_start(CProfiler::enabled() ? CProfileClock::now() : 0) {}
+
+    ~CProfileScope() {
+        if ( m_start ) {
+            CProfiler::instance().record(m_probe, CProfileClock::now() - m_start);
+        }
+    }
+
+    CProfileScope(const CProfileScope &) = delete;
+    CProfileScope & operator=(const CProfileScope &) = delete;
+
+private:
+    std::size_t m_probe;
+    CProfileClock::Ticks m_start;
+};
+
+#define PROFILE_CONCAT2_(a, b) a##b
+#define PROFILE_CONCAT_(a, b) PROFILE_CONCAT2_(a, b)
+
+// the probe is registered once per call site, the scope ends with the enclosing block
+#define PROFILE_SCOPE(name) \
+    static const std::size_t PROFILE_CONCAT_(profileProbe_, __LINE__) = CProfiler::instance().probe(name); \
+    const CProfileScope PROFILE_CONCAT_(profileScope_, __LINE__)(PROFILE_CONCAT_(profileProbe_, __LINE__))
+
+#define PROFILE_COUNT(name, n) \
+    do { \
+        static const std::size_t profileProbe_ = CProfiler::instance().probe(name); \
+        if ( CProfiler::enabled() ) { \
+            CProfiler::instance().count(profileProbe_, n); \
+        } \
+    } while ( false )
+
+#endif /* PROFILER_H_ */
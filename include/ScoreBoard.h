@@ -0,0 +1,193 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for ScoreBoard.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef SCOREBOARD_H_
+#define SCOREBOARD_H_
+
+#include "StringPool.h"
+#include "StringRef.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/* Ingest and ranking of student scores, the bulk version of ReportCard in
+ * BraceInitialization.cpp.
+ *
+ * A score is stored as name id and value: names are interned into a
+ * CStringPool, so ingesting a score copies no std::string, and with
+ * reserve() up front the only allocations left are those for new distinct
+ * names. Rankings are kept up to date on every insert instead of sorting on
+ * demand:
+ *  - the best topCount scores in a min heap (the worst of them on top)
+ *  - a count per score value in a Fenwick tree, which answers percentile
+ *    and "how many are at least" queries in O(log(score range))
+ */
+class CScoreBoard {
+public:
+    struct CScore {
+        CStringPool::Id m_nameId;
+        int m_iScore;
+    };
+
+    struct CRankedScore {
+        CStringRef m_name;
+        int m_iScore;
+    };
+
+    CScoreBoard(std::size_t topCount, int iMinScore = 0, int iMaxScore = 100) :
+        m_topCount(topCount),
+        m_iMinScore(iMinScore),
+        m_iMaxScore(iMaxScore),
+        m_vecCounts(treeSize(iMinScore, iMaxScore), 0) {
+        m_vecTop.reserve(topCount);
+    }
+
+    void reserve(std::size_t scores, std::size_t names) {
+        m_vecScores.reserve(scores);
+        m_names.reserve(names);
+    }
+
+    void addStudentScore(CStringRef name, int iScore) {
+        if ( iScore < m_iMinScore || iScore > m_iMaxScore ) {
+            throw std::out_of_range("CScoreBoard::addStudentScore: score out of range");
+        }
+        const CScore score = { m_names.intern(name), iScore };
+        updateTop(score, m_vecScores.size());
+        m_vecScores.push_back(score);
+        for ( std::size_t i = position(iScore); i < m_vecCounts.size(); i += i & (~i + 1) ) {
+            ++m_vecCounts[i];
+        }
+    }
+
+    std::size_t size() const {
+        return m_vecScores.size();
+    }
+
+    const std::vector<CScore> & scores() const {
+        return m_vecScores;
+    }
+
+    CStringRef name(CStringPool::Id id) const {
+        return m_names.str(id);
+    }
+
+    // best first, equal scores in order of insertion
+    std::vector<CRankedScore> top() const {
+        std::vector<CTopEntry> vecSorted(m_vecTop);
+        std::sort(vecSorted.begin(), vecSorted.end(), &isBetter);
+        std::vector<CRankedScore> vecResult;
+        vecResult.reserve(vecSorted.size());
+        for ( auto& entry : vecSorted ) {
+            vecResult.push_back(CRankedScore{ m_names.str(entry.m_score.m_nameId), entry.m_score.m_iScore });
+        }
+        return vecResult;
+    }
+
+    // number of scores <= iScore
+    std::size_t countAtMost(int iScore) const {
+        if ( iScore < m_iMinScore ) {
+            return 0;
+        }
+        std::size_t count = 0;
+        for ( std::size_t i = position(std::min(iScore, m_iMaxScore)); i > 0; i -= i & (~i + 1) ) {
+            count += m_vecCounts[i];
+        }
+        return count;
+    }
+
+    std::size_t countAtLeast(int iScore) const {
+        // iScore - 1 would overflow for INT_MIN
+        if ( iScore <= m_iMinScore ) {
+            return size();
+        }
+        return size() - countAtMost(iScore - 1);
+    }
+
+    // nearest rank percentile: smallest score with at least percent % of all scores <= it
+    int percentile(double percent) const {
+        if ( m_vecScores.empty() ) {
+            throw std::logic_error("CScoreBoard::percentile: no scores");
+        }
+        // also rejects NaN
+        if ( !(percent >= 0.0 && percent <= 100.0) ) {
+            throw std::out_of_range("CScoreBoard::percentile: percent not in [0, 100]");
+        }
+        std::size_t rank = static_cast<std::size_t>(std::ceil(percent / 100.0 * size()));
+        rank = std::max<std::size_t>(1, std::min(rank, size()));
+
+        // descend the Fenwick tree to the largest position with count < rank
+        std::size_t position = 0;
+        std::size_t step = 1;
+        while ( step * 2 < m_vecCounts.size() ) {
+            step *= 2;
+        }
+        for ( ; step > 0; step /= 2 ) {
+            if ( position + step < m_vecCounts.size() && m_vecCounts[position + step] < rank ) {
+                position += step;
+                rank -= m_vecCounts[position];
+            }
+        }
+        return static_cast<int>(static_cast<long long>(m_iMinScore) + static_cast<long long>(position));
+    }
+
+private:
+    struct CTopEntry {
+        CScore m_score;
+        std::size_t m_sequence;
+    };
+
+    static std::size_t treeSize(int iMinScore, int iMaxScore) {
+        if ( iMinScore > iMaxScore ) {
+            throw std::invalid_argument("CScoreBoard: empty score range");
+        }
+        return static_cast<std::size_t>(static_cast<long long>(iMaxScore) - iMinScore) + 2;
+    }
+
+    // of iScore in the Fenwick tree, computed wide: the score range may span all of int
+    std::size_t position(int iScore) const {
+        return static_cast<std::size_t>(static_cast<long long>(iScore) - m_iMinScore) + 1;
+    }
+
+    static bool isBetter(const CTopEntry & lhs, const CTopEntry & rhs) {
+        return lhs.m_score.m_iScore > rhs.m_score.m_iScore
+                || (lhs.m_score.m_iScore == rhs.m_score.m_iScore && lhs.m_sequence < rhs.m_sequence);
+    }
+
+    void updateTop(const CScore & score, std::size_t sequence) {
+        const CTopEntry entry = { score, sequence };
+        if ( m_vecTop.size() < m_topCount ) {
+            m_vecTop.push_back(entry);
+            std::push_heap(m_vecTop.begin(), m_vecTop.end(), &isBetter);
+        }
+        else if ( m_topCount > 0 && isBetter(entry, m_vecTop.front()) ) {
+            std::pop_heap(m_vecTop.begin(), m_vecTop.end(), &isBetter);
+            m_vecTop.back() = entry;
+            std::push_heap(m_vecTop.begin(), m_vecTop.end(), &isBetter);
+        }
+    }
+
+    std::size_t m_topCount;
+    int m_iMinScore;
+    int m_iMaxScore;
+    CStringPool m_names;
+    std::vector<CScore> m_vecScores;
+    std::vector<CTopEntry> m_vecTop;         // heap, worst of the best on top
+    std::vector<std::uint32_t> m_vecCounts;  // Fenwick tree over score - m_iMinScore, 1 based
+};
+
+#endif /* SCOREBOARD_H_ */
@@ -0,0 +1,190 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for SortedFlatMap.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef SORTEDFLATMAP_H_
+#define SORTEDFLATMAP_H_
+
+#include "StringRef.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/* Map on a sorted std::vector: one allocation for all entries, binary search
+ * on contiguous memory, cheap in order iteration. Inserting a single entry
+ * shifts the tail, so build it in bulk (constructor or insert(first, last))
+ * and use it for lookups.
+ *
+ * Keys must not be modified through iterators. Lookups are templates: with
+ * the transparent CFlatLess of std::string keys they accept a CStringRef.
+ */
+template <typename Key, typename Value, typename Compare = CFlatLess<Key>>
+class CSortedFlatMap {
+public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<Key, Value> value_type;
+    typedef std::size_t size_type;
+    typedef typename std::vector<value_type>::iterator iterator;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    CSortedFlatMap() {}
+
+    CSortedFlatMap(std::initializer_list<value_type> values) {
+        insert(values.begin(), values.end());
+    }
+
+    template <typename InputIt>
+    CSortedFlatMap(InputIt first, InputIt last) {
+        insert(first, last);
+    }
+
+    iterator begin() { return m_vecEntries.begin(); }
+    iterator end() { return m_vecEntries.end(); }
+    const_iterator begin() const { return m_vecEntries.begin(); }
+    const_iterator end() const { return m_vecEntries.end(); }
+
+    size_type size() const { return m_vecEntries.size(); }
+    bool empty() const { return m_vecEntries.empty(); }
+    void reserve(size_type count) { m_vecEntries.reserve(count); }
+    void clear() { m_vecEntries.clear(); }
+
+    template <typename K>
+    iterator lower_bound(const K & key) {
+        return std::lower_bound(m_vecEntries.begin(), m_vecEntries.end(), key, CEntryLess(m_less));
+    }
+
+    template <typename K>
+    const_iterator lower_bound(const K & key) const {
+        return std::lower_bound(m_vecEntries.begin(), m_vecEntries.end(), key, CEntryLess(m_less));
+    }
+
+    template <typename K>
+    iterator find(const K & key) {
+        iterator itr = lower_bound(key);
+        return itr != end() && !m_less(key, itr->first) ? itr : end();
+    }
+
+    template <typename K>
+    const_iterator find(const K & key) const {
+        const_iterator itr = lower_bound(key);
+        return itr != end() && !m_less(key, itr->first) ? itr : end();
+    }
+
+    template <typename K>
+    size_type count(const K & key) const {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    template <typename K>
+    Value & at(const K & key) {
+        iterator itr = find(key);
+        if ( itr == end() ) {
+            throw std::out_of_range("CSortedFlatMap::at: key not found");
+        }
+        return itr->second;
+    }
+
+    template <typename K>
+    const Value & at(const K & key) const {
+        return const_cast<CSortedFlatMap *>(this)->at(key);
+    }
+
+    Value & operator[] (const Key & key) {
+        return tryEmplace(key).first->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type & value) {
+        return tryEmplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type && value) {
+        return tryEmplace(std::move(value.first), std::move(value.second));
+    }
+
+    /* bulk insert: append, sort the new entries and merge them in, O(n log n)
+     * instead of O(n^2) for inserting one by one. As with std::map the first
+     * of several equal keys wins. */
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        const std::size_t oldSize = m_vecEntries.size();
+        m_vecEntries.insert(m_vecEntries.end(), first, last);
+        CEntryLess less(m_less);
+        std::stable_sort(m_vecEntries.begin() + oldSize, m_vecEntries.end(), less);
+        std::inplace_merge(m_vecEntries.begin(), m_vecEntries.begin() + oldSize, m_vecEntries.end(), less);
+        m_vecEntries.erase(std::unique(m_vecEntries.begin(), m_vecEntries.end(),
+                [&less] (const value_type & lhs, const value_type & rhs) { return !less(lhs, rhs); } ),
+                m_vecEntries.end());
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplace(K && key, Args &&... args) {
+        iterator itr = lower_bound(key);
+        if ( itr != end() && !m_less(key, itr->first) ) {
+            return std::make_pair(itr, false);
+        }
+        itr = m_vecEntries.emplace(itr, std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+        return std::make_pair(itr, true);
+    }
+
+    template <typename K>
+    size_type erase(const K & key) {
+        iterator itr = find(key);
+        if ( itr == end() ) {
+            return 0;
+        }
+        m_vecEntries.erase(itr);
+        return 1;
+    }
+
+    iterator erase(const_iterator pos) {
+        return m_vecEntries.erase(pos);
+    }
+
+    // else erase(find(key)) would pick the key template above
+    iterator erase(iterator pos) {
+        return m_vecEntries.erase(pos);
+    }
+
+private:
+    // compares entries with entries or keys by key
+    class CEntryLess {
+    public:
+        explicit CEntryLess(const Compare & less) : m_less(less) {}
+
+        bool operator() (const value_type & lhs, const value_type & rhs) const {
+            return m_less(lhs.first, rhs.first);
+        }
+
+        template <typename K>
+        bool operator() (const value_type & lhs, const K & key) const {
+            return m_less(lhs.first, key);
+        }
+
+    private:
+        const Compare & m_less;
+    };
+
+    std::vector<value_type> m_vecEntries;
+    Compare m_less;
+};
+
+#endif /* SORTEDFLATMAP_H_ */
@@ -0,0 +1,94 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for StringPool.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef STRINGPOOL_H_
+#define STRINGPOOL_H_
+
+#include "FlatHashMap.h"
+#include "StringRef.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/* Interns strings: every distinct string is stored once and gets a small id.
+ * The characters live in large blocks which never move, so the CStringRef
+ * handed out stay valid as long as the pool exists. Interning a string seen
+ * before neither allocates nor copies.
+ */
+class CStringPool {
+public:
+    typedef std::uint32_t Id;
+
+    CStringPool() : m_blockUsed(BLOCK_SIZE) {}
+
+    CStringPool(const CStringPool &) = delete;
+    CStringPool & operator=(const CStringPool &) = delete;
+
+    Id intern(CStringRef str) {
+        auto itr = m_mapIds.find(str);
+        if ( itr != m_mapIds.end() ) {
+            return itr->second;
+        }
+        Id id = static_cast<Id>(m_vecStrings.size());
+        m_vecStrings.push_back(store(str));
+        m_mapIds.tryEmplace(m_vecStrings.back(), id);
+        return id;
+    }
+
+    CStringRef str(Id id) const {
+        return m_vecStrings[id];
+    }
+
+    std::size_t size() const {
+        return m_vecStrings.size();
+    }
+
+    // room for count distinct strings without rehashing
+    void reserve(std::size_t count) {
+        m_vecStrings.reserve(count);
+        m_mapIds.reserve(count);
+    }
+
+private:
+    static const std::size_t BLOCK_SIZE = 64 * 1024;
+
+    CStringRef store(CStringRef str) {
+        if ( str.size() > BLOCK_SIZE ) {
+            // a block of its own, placed before the current block, which stays current
+            std::unique_ptr<char[]> pBlock(new char[str.size()]);
+            std::memcpy(pBlock.get(), str.data(), str.size());
+            CStringRef result(pBlock.get(), str.size());
+            m_vecBlocks.insert(m_vecBlocks.empty() ? m_vecBlocks.end() : m_vecBlocks.end() - 1, std::move(pBlock));
+            return result;
+        }
+        if ( m_vecBlocks.empty() || str.size() > BLOCK_SIZE - m_blockUsed ) {
+            m_vecBlocks.emplace_back(new char[BLOCK_SIZE]);
+            m_blockUsed = 0;
+        }
+        char * pData = m_vecBlocks.back().get() + m_blockUsed;
+        std::memcpy(pData, str.data(), str.size());
+        m_blockUsed += str.size();
+        return CStringRef(pData, str.size());
+    }
+
+    std::vector<std::unique_ptr<char[]>> m_vecBlocks;
+    std::size_t m_blockUsed;
+    std::vector<CStringRef> m_vecStrings;
+    CFlatHashMap<CStringRef, Id> m_mapIds;
+};
+
+#endif /* STRINGPOOL_H_ */
@@ -0,0 +1,125 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for StringRef.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef STRINGREF_H_
+#define STRINGREF_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+/* Non owning view of characters (pointer and length), i.e. what
+ * std::string_view is in C++17. Converts implicitly from std::string and
+ * string literals, so containers can look up std::string keys without
+ * building a temporary std::string.
+ */
+class CStringRef {
+public:
+    CStringRef() : m_pData(""), m_size(0) {}
+    CStringRef(const char * pData) : m_pData(pData), m_size(std::strlen(pData)) {}
+    CStringRef(const char * pData, std::size_t size) : m_pData(pData), m_size(size) {}
+    CStringRef(const std::string & str) : m_pData(str.data()), m_size(str.size()) {}
+
+    const char * data() const { return m_pData; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    std::string str() const { return std::string(m_pData, m_size); }
+
+    int compare(CStringRef other) const {
+        int result = std::memcmp(m_pData, other.m_pData, std::min(m_size, other.m_size));
+        if ( result != 0 ) {
+            return result;
+        }
+        return m_size < other.m_size ? -1 : (m_size > other.m_size ? 1 : 0);
+    }
+
+private:
+    const char * m_pData;
+    std::size_t m_size;
+};
+
+inline bool operator== (CStringRef lhs, CStringRef rhs) {
+    return lhs.size() == rhs.size() && std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+inline bool operator!= (CStringRef lhs, CStringRef rhs) {
+    return !(lhs == rhs);
+}
+
+inline bool operator< (CStringRef lhs, CStringRef rhs) {
+    return lhs.compare(rhs) < 0;
+}
+
+/* hash of the characters, 8 bytes per step */
+inline std::uint64_t hashBytes(const char * pData, std::size_t size) {
+    const std::uint64_t K = 0x9E3779B97F4A7C15ull;
+    std::uint64_t hash = size * K;
+    for ( ; size >= 8; pData += 8, size -= 8 ) {
+        std::uint64_t word;
+        std::memcpy(&word, pData, 8);
+        hash = (hash ^ (word * K)) * K;
+    }
+    std::uint64_t word = 0;
+    std::memcpy(&word, pData, size);
+    return (hash ^ (word * K)) * K;
+}
+
+
+/* hash, equality and ordering functors of the flat maps. For std::string
+ * keys they are transparent: they accept anything convertible to CStringRef.
+ */
+template <typename Key>
+struct CFlatHash : std::hash<Key> {};
+
+template <>
+struct CFlatHash<std::string> {
+    std::size_t operator() (CStringRef str) const {
+        return hashBytes(str.data(), str.size());
+    }
+};
+
+template <typename Key>
+struct CFlatEqual : std::equal_to<Key> {};
+
+template <>
+struct CFlatEqual<std::string> {
+    bool operator() (CStringRef lhs, CStringRef rhs) const {
+        return lhs == rhs;
+    }
+};
+
+template <typename Key>
+struct CFlatLess : std::less<Key> {};
+
+template <>
+struct CFlatLess<std::string> {
+    bool operator() (CStringRef lhs, CStringRef rhs) const {
+        return lhs < rhs;
+    }
+};
+
+template <>
+struct CFlatHash<CStringRef> : CFlatHash<std::string> {};
+
+template <>
+struct CFlatEqual<CStringRef> : CFlatEqual<std::string> {};
+
+template <>
+struct CFlatLess<CStringRef> : CFlatLess<std::string> {};
+
+#endif /* STRINGREF_H_ */
@@ -0,0 +1,179 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for TiledMultiply.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef TILEDMULTIPLY_H_
+#define TILEDMULTIPLY_H_
+
+#include "BlockThreads.h"
+#include "Matrix.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* c += alpha * a * b for large row major matrices.
+ *
+ * b is cut into TILE_K x TILE_N tiles. Each tile is copied ("packed") into
+ * strips of 4 columns, so the kernel reads it sequentially, and stays in
+ * the cache while all rows of a run over it. The kernel computes 4 x 4
+ * elements of c at a time in registers.
+ *
+ * The matrices are given as pointer and row distance (lda, ldb, ldc), so
+ * they can be blocks of bigger matrices, as needed by the factorizations
+ * in MatrixFactorization.h.
+ */
+class CTiledMultiply {
+public:
+    enum { TILE_K = 256, TILE_N = 256, ROWS_PER_BLOCK = 64 };
+
+    // row blocks of c in parallel
+    static void multiplyAdd(std::size_t m, std::size_t n, std::size_t k, double alpha,
+                            const double * a, std::size_t lda,
+                            const double * b, std::size_t ldb,
+                            double * c, std::size_t ldc) {
+        std::vector<double> vecPacked;
+        for ( std::size_t column = 0; column < n; column += TILE_N ) {
+            const std::size_t columns = std::min<std::size_t>(TILE_N, n - column);
+            for ( std::size_t p = 0; p < k; p += TILE_K ) {
+                const std::size_t depth = std::min<std::size_t>(TILE_K, k - p);
+                pack(depth, columns, b + p * ldb + column, ldb, vecPacked);
+                const double * pPacked = vecPacked.data();
+                parallelBlocks((m + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK, [=] (std::size_t block) {
+                    const std::size_t row = block * ROWS_PER_BLOCK;
+                    multiplyPacked(std::min<std::size_t>(ROWS_PER_BLOCK, m - row), columns, depth, alpha,
+                                   a + row * lda + p, lda, pPacked, c + row * ldc + column, ldc);
+                } );
+            }
+        }
+    }
+
+    // the same in the calling thread, for callers which are parallel themselves
+    static void multiplyAddSerial(std::size_t m, std::size_t n, std::size_t k, double alpha,
+                                  const double * a, std::size_t lda,
+                                  const double * b, std::size_t ldb,
+                                  double * c, std::size_t ldc) {
+        std::vector<double> vecPacked;
+        for ( std::size_t column = 0; column < n; column += TILE_N ) {
+            const std::size_t columns = std::min<std::size_t>(TILE_N, n - column);
+            for ( std::size_t p = 0; p < k; p += TILE_K ) {
+                const std::size_t depth = std::min<std::size_t>(TILE_K, k - p);
+                pack(depth, columns, b + p * ldb + column, ldb, vecPacked);
+                multiplyPacked(m, columns, depth, alpha, a + p, lda, vecPacked.data(), c + column, ldc);
+            }
+        }
+    }
+
+private:
+    // strip s holds columns 4s .. 4s + 3 of b row after row, missing columns are 0
+    static void pack(std::size_t depth, std::size_t columns, const double * b, std::size_t ldb,
+                     std::vector<double> & vecPacked) {
+        const std::size_t strips = (columns + 3) / 4;
+        vecPacked.assign(strips * depth * 4, 0.0);
+        for ( std::size_t strip = 0; strip < strips; ++strip ) {
+            const std::size_t width = std::min<std::size_t>(4, columns - 4 * strip);
+            double * pOut = vecPacked.data() + strip * depth * 4;
+            for ( std::size_t q = 0; q < depth; ++q ) {
+                const double * pRow = b + q * ldb + 4 * strip;
+                for ( std::size_t t = 0; t < width; ++t ) {
+                    pOut[4 * q + t] = pRow[t];
+                }
+            }
+        }
+    }
+
+    static void multiplyPacked(std::size_t rows, std::size_t columns, std::size_t depth, double alpha,
+                               const double * a, std::size_t lda, const double * pPacked,
+                               double * c, std::size_t ldc) {
+        for ( std::size_t row = 0; row < rows; row += 4 ) {
+            const std::size_t height = std::min<std::size_t>(4, rows - row);
+            // missing rows repeat the last one, their results are dropped
+            const double * pRows[4];
+            for ( std::size_t r = 0; r < 4; ++r ) {
+                pRows[r] = a + (row + std::min(r, height - 1)) * lda;
+            }
+            for ( std::size_t strip = 0; 4 * strip < columns; ++strip ) {
+                const std::size_t width = std::min<std::size_t>(4, columns - 4 * strip);
+                double block[16];
+                kernel(depth, pRows, pPacked + strip * depth * 4, block);
+                for ( std::size_t r = 0; r < height; ++r ) {
+                    double * pOut = c + (row + r) * ldc + 4 * strip;
+                    for ( std::size_t t = 0; t < width; ++t ) {
+                        pOut[t] += alpha * block[4 * r + t];
+                    }
+                }
+            }
+        }
+    }
+
+    // block = 4 rows of a times one packed strip
+    static void kernel(std::size_t depth, const double * const pRows[4], const double * pStrip, double block[16]) {
+#ifdef __SSE2__
+        __m128d c00 = _mm_setzero_pd(), c01 = _mm_setzero_pd();
+        __m128d c10 = _mm_setzero_pd(), c11 = _mm_setzero_pd();
+        __m128d c20 = _mm_setzero_pd(), c21 = _mm_setzero_pd();
+        __m128d c30 = _mm_setzero_pd(), c31 = _mm_setzero_pd();
+        for ( std::size_t q = 0; q < depth; ++q, pStrip += 4 ) {
+            const __m128d b0 = _mm_loadu_pd(pStrip);
+            const __m128d b1 = _mm_loadu_pd(pStrip + 2);
+            __m128d a = _mm_set1_pd(pRows[0][q]);
+            c00 = _mm_add_pd(c00, _mm_mul_pd(a, b0));
+            c01 = _mm_add_pd(c01, _mm_mul_pd(a, b1));
+            a = _mm_set1_pd(pRows[1][q]);
+            c10 = _mm_add_pd(c10, _mm_mul_pd(a, b0));
+            c11 = _mm_add_pd(c11, _mm_mul_pd(a, b1));
+            a = _mm_set1_pd(pRows[2][q]);
+            c20 = _mm_add_pd(c20, _mm_mul_pd(a, b0));
+            c21 = _mm_add_pd(c21, _mm_mul_pd(a, b1));
+            a = _mm_set1_pd(pRows[3][q]);
+            c30 = _mm_add_pd(c30, _mm_mul_pd(a, b0));
+            c31 = _mm_add_pd(c31, _mm_mul_pd(a, b1));
+        }
+        _mm_storeu_pd(block, c00);
+        _mm_storeu_pd(block + 2, c01);
+        _mm_storeu_pd(block + 4, c10);
+        _mm_storeu_pd(block + 6, c11);
+        _mm_storeu_pd(block + 8, c20);
+        _mm_storeu_pd(block + 10, c21);
+        _mm_storeu_pd(block + 12, c30);
+        _mm_storeu_pd(block + 14, c31);
+#else
+        std::fill(block, block + 16, 0.0);
+        for ( std::size_t q = 0; q < depth; ++q, pStrip += 4 ) {
+            for ( std::size_t r = 0; r < 4; ++r ) {
+                for ( std::size_t t = 0; t < 4; ++t ) {
+                    block[4 * r + t] += pRows[r][q] * pStrip[t];
+                }
+            }
+        }
+#endif
+    }
+};
+
+/* the product CMatrix::operator* of Move.cpp only pretends to compute */
+inline CMatrix multiply(const CMatrix & a, const CMatrix & b) {
+    if ( a.columns() != b.rows() ) {
+        throw std::invalid_argument("multiply: matrix sizes do not match");
+    }
+    CMatrix result(a.rows(), b.columns());
+    CTiledMultiply::multiplyAdd(a.rows(), b.columns(), a.columns(), 1.0,
+                                a.data(), a.columns(), b.data(), b.columns(), result.data(), result.columns());
+    return result;
+}
+
+#endif /* TILEDMULTIPLY_H_ */
@@ -0,0 +1,45 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for TotalCost.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef TOTALCOST_H_
+#define TOTALCOST_H_
+
+#include <numeric>
+#include <vector>
+
+/* the extended example of Loops.cpp: the same sum with a range based loop
+ * and with std::accumulate and a lambda */
+
+class CItem {
+public:
+   CItem(int cost) : cost_{cost} {}
+   int Cost() { return cost_; }
+private:
+   int cost_;
+};
+
+inline int TotalCost(std::vector<CItem>&& items) {
+   int total{0};
+   for (auto item: items) {
+       total += item.Cost();
+   }
+   return total;
+}
+
+inline int LambdaTotalCost(std::vector<CItem>&& items) {
+   return std::accumulate(items.begin(), items.end(), 0,
+     [] (int total, CItem item) { return total + item.Cost(); });
+}
+
+#endif /* TOTALCOST_H_ */
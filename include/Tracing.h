@@ -0,0 +1,168 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for Tracing.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef TRACING_H_
+#define TRACING_H_
+
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/* Counts allocations, copies and moves per thread.
+ *
+ * Allocations are counted by the replaced global operator new / delete in
+ * src/Tracing.cpp, i.e. always. Copies and moves are counted for objects
+ * wrapped in CTracked<T>. A CTraceScope reports what happened on its thread
+ * since it was created; see TracingMatchers.h for the gtest side.
+ *
+ * Only the plain and the nothrow forms of new / delete are replaced. The
+ * sized delete of C++14 ends up in the plain one in libstdc++, but the
+ * aligned forms of C++17 (types with alignas beyond alignof(max_align_t))
+ * go straight to the library: from C++17 on such allocations are missing
+ * in the counters.
+ */
+struct CTraceCounters {
+    std::size_t m_allocations;
+    std::size_t m_deallocations;
+    std::size_t m_bytes;  // allocated
+    std::size_t m_copies;
+    std::size_t m_moves;
+};
+
+inline CTraceCounters operator- (const CTraceCounters & lhs, const CTraceCounters & rhs) {
+    return CTraceCounters{
+        lhs.m_allocations - rhs.m_allocations,
+        lhs.m_deallocations - rhs.m_deallocations,
+        lhs.m_bytes - rhs.m_bytes,
+        lhs.m_copies - rhs.m_copies,
+        lhs.m_moves - rhs.m_moves };
+}
+
+inline std::ostream & operator<< (std::ostream & out, const CTraceCounters & counters) {
+    return out << counters.m_allocations << " allocations (" << counters.m_bytes << " bytes), "
+               << counters.m_deallocations << " deallocations, "
+               << counters.m_copies << " copies, " << counters.m_moves << " moves";
+}
+
+// counters of the calling thread, defined in src/Tracing.cpp
+CTraceCounters & threadTraceCounters();
+
+// > 0 while the calling thread does not count allocations
+unsigned int & threadTracePauseDepth();
+
+/* allocations of the calling thread are not counted while a CTracePause
+ * lives, e.g. those of the test framework checking the counters */
+class CTracePause {
+public:
+    CTracePause() {
+        ++threadTracePauseDepth();
+    }
+
+    ~CTracePause() {
+        --threadTracePauseDepth();
+    }
+
+    CTracePause(const CTracePause &) = delete;
+    CTracePause & operator=(const CTracePause &) = delete;
+};
+
+
+class CTraceScope {
+public:
+    CTraceScope() : m_start(threadTraceCounters()), m_pOuter(current()) {
+        current() = this;
+    }
+
+    ~CTraceScope() {
+        current() = m_pOuter;
+    }
+
+    CTraceScope(const CTraceScope &) = delete;
+    CTraceScope & operator=(const CTraceScope &) = delete;
+
+    // what happened since construction (or the last reset)
+    CTraceCounters counters() const {
+        return threadTraceCounters() - m_start;
+    }
+
+    std::size_t allocations() const { return counters().m_allocations; }
+    std::size_t bytes() const { return counters().m_bytes; }
+    std::size_t copies() const { return counters().m_copies; }
+    std::size_t moves() const { return counters().m_moves; }
+
+    void reset() {
+        m_start = threadTraceCounters();
+    }
+
+    // the most recently created scope of this thread which is still alive
+    static CTraceScope & innermost() {
+        if ( !current() ) {
+            throw std::logic_error("CTraceScope::innermost: no trace scope on this thread");
+        }
+        return *current();
+    }
+
+private:
+    static CTraceScope *& current() {
+        static thread_local CTraceScope * pCurrent = nullptr;
+        return pCurrent;
+    }
+
+    CTraceCounters m_start;
+    CTraceScope * m_pOuter;
+};
+
+
+/* T plus counting of copies and moves */
+template <typename T>
+class CTracked {
+public:
+    CTracked() : m_value() {}
+    CTracked(const T & value) : m_value(value) {}
+    CTracked(T && value) : m_value(std::move(value)) {}
+
+    CTracked(const CTracked & other) : m_value(other.m_value) {
+        ++threadTraceCounters().m_copies;
+    }
+
+    // as noexcept as T, so containers pick moves or copies just like for T
+    CTracked(CTracked && other) noexcept(std::is_nothrow_move_constructible<T>::value) :
+        m_value(std::move(other.m_value)) {
+        ++threadTraceCounters().m_moves;
+    }
+
+    CTracked & operator= (const CTracked & other) {
+        m_value = other.m_value;
+        ++threadTraceCounters().m_copies;
+        return *this;
+    }
+
+    CTracked & operator= (CTracked && other) noexcept(std::is_nothrow_move_assignable<T>::value) {
+        m_value = std::move(other.m_value);
+        ++threadTraceCounters().m_moves;
+        return *this;
+    }
+
+    T & get() { return m_value; }
+    const T & get() const { return m_value; }
+    operator T & () { return m_value; }
+    operator const T & () const { return m_value; }
+
+private:
+    T m_value;
+};
+
+#endif /* TRACING_H_ */
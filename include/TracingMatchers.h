@@ -0,0 +1,62 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Header file for TracingMatchers.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#ifndef TRACINGMATCHERS_H_
+#define TRACINGMATCHERS_H_
+
+#include "Tracing.h"
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+/* gmock matchers on CTraceCounters, taking a number or a matcher:
+ *
+ *     CTraceScope trace;
+ *     hotPath();
+ *     EXPECT_ALLOCATIONS(0);
+ *     EXPECT_COPIES(::testing::Le(1));
+ *     EXPECT_THAT(trace.counters(), HasMoves(2));
+ */
+MATCHER_P(HasAllocations, matcher, "") {
+    return ::testing::ExplainMatchResult(matcher, arg.m_allocations, result_listener);
+}
+
+MATCHER_P(HasAllocatedBytes, matcher, "") {
+    return ::testing::ExplainMatchResult(matcher, arg.m_bytes, result_listener);
+}
+
+MATCHER_P(HasCopies, matcher, "") {
+    return ::testing::ExplainMatchResult(matcher, arg.m_copies, result_listener);
+}
+
+MATCHER_P(HasMoves, matcher, "") {
+    return ::testing::ExplainMatchResult(matcher, arg.m_moves, result_listener);
+}
+
+/* check the innermost CTraceScope; the counting is paused while gmock
+ * checks, so one check does not show up in the next. Other assertions
+ * allocate too: keep them out of the traced code. */
+#define EXPECT_TRACE_COUNTERS_(matcher) \
+    do { \
+        const CTraceCounters traceCounters_ = CTraceScope::innermost().counters(); \
+        const CTracePause tracePause_; \
+        EXPECT_THAT(traceCounters_, matcher); \
+    } while ( false )
+
+#define EXPECT_ALLOCATIONS(matcher) EXPECT_TRACE_COUNTERS_(HasAllocations(matcher))
+#define EXPECT_ALLOCATED_BYTES(matcher) EXPECT_TRACE_COUNTERS_(HasAllocatedBytes(matcher))
+#define EXPECT_COPIES(matcher) EXPECT_TRACE_COUNTERS_(HasCopies(matcher))
+#define EXPECT_MOVES(matcher) EXPECT_TRACE_COUNTERS_(HasMoves(matcher))
+
+#endif /* TRACINGMATCHERS_H_ */
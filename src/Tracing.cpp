@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------------*/
+/** \file
+ * Source file for Tracing.
+ *
+ * \author weigand
+ *
+ * (C) Copyright 2013 by TriaGnoSys GmbH, 82234 Wessling, Germany
+ *
+ * \verbatim
+ * $Id:$
+ * \endverbatim
+ */
+/*---------------------------------------------------------------------------*/
+
+#include "Tracing.h"
+
+#include <cstdlib>
+#include <new>
+
+/* Replaces the global operator new / delete to count allocations per thread.
+ * Must be linked exactly once into each executable using Tracing.h.
+ */
+
+namespace {
+
+// plain data, so the thread local needs no constructor when operator new first touches it
+thread_local CTraceCounters threadCounters = { 0, 0, 0, 0, 0 };
+thread_local unsigned int threadPauseDepth = 0;
+
+void * countedAllocate(std::size_t size) {
+    for (;;) {
+        void * p = std::malloc(size ? size : 1);
+        if ( p ) {
+            if ( threadPauseDepth == 0 ) {
+                ++threadCounters.m_allocations;
+                threadCounters.m_bytes += size;
+            }
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if ( !handler ) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void countedFree(void * p) {
+    if ( p ) {
+        if ( threadPauseDepth == 0 ) {
+            ++threadCounters.m_deallocations;
+        }
+        std::free(p);
+    }
+}
+
+} // namespace
+
+CTraceCounters & threadTraceCounters() {
+    return threadCounters;
+}
+
+unsigned int & threadTracePauseDepth() {
+    return threadPauseDepth;
+}
+
+void * operator new (std::size_t size) {
+    return countedAllocate(size);
+}
+
+void * operator new[] (std::size_t size) {
+    return countedAllocate(size);
+}
+
+void * operator new (std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size);
+    }
+    catch ( const std::bad_alloc & ) {
+        return nullptr;
+    }
+}
+
+void * operator new[] (std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return countedAllocate(size);
+    }
+    catch ( const std::bad_alloc & ) {
+        return nullptr;
+    }
+}
+
+void operator delete (void * p) noexcept {
+    countedFree(p);
+}
+
+void operator delete[] (void * p) noexcept {
+    countedFree(p);
+}
+
+void operator delete (void * p, const std::nothrow_t &) noexcept {
+    countedFree(p);
+}
+
+void operator delete[] (void * p, const std::nothrow_t &) noexcept {
+    countedFree(p);
+}